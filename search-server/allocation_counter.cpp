@@ -0,0 +1,61 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+thread_local uint64_t allocation_count = 0;
+}
+
+#ifdef SEARCH_SERVER_COUNT_ALLOCATIONS
+
+// Остальные формы operator new по умолчанию вызывают эту
+void* operator new(std::size_t size)
+{
+    ++allocation_count;
+    while (true)
+    {
+        if (void* const data = std::malloc(size == 0 ? 1 : size))
+        {
+            return data;
+        }
+        const std::new_handler handler = std::get_new_handler();
+        if (!handler)
+        {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void* data) noexcept
+{
+    std::free(data);
+}
+
+void operator delete(void* data, [[__maybe_unused__]]std::size_t size) noexcept
+{
+    std::free(data);
+}
+
+#endif
+
+AllocationCounter::AllocationCounter()
+    : start_count_(allocation_count)
+{
+}
+
+uint64_t AllocationCounter::GetCount() const
+{
+    return allocation_count - start_count_;
+}
+
+bool AllocationCounter::IsEnabled()
+{
+#ifdef SEARCH_SERVER_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// Считает выделения памяти через глобальный operator new в текущем потоке с момента создания.
+// Подмена operator new включается только при сборке с -DSEARCH_SERVER_COUNT_ALLOCATIONS, для тестов
+// и замеров: счётчик - одно увеличение thread_local переменной, память по-прежнему выделяет malloc.
+// Без флага программа работает со стандартным operator new, а GetCount всегда возвращает 0.
+class AllocationCounter
+{
+private:
+    uint64_t start_count_;
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    AllocationCounter();
+
+    //------------------GETS-----------------//
+    uint64_t GetCount() const;
+    // Собрана ли программа с подсчётом выделений
+    static bool IsEnabled();
+};
@@ -0,0 +1,106 @@
+#include "compressed_postings.h"
+
+#include <algorithm>
+
+void CompressedPostings::WriteVarint(uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes_.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes_.push_back(static_cast<uint8_t>(value));
+}
+
+void CompressedPostings::Add(uint32_t ordinal, uint32_t count)
+{
+    if (blocks_.empty() || blocks_.back().size == POSTINGS_BLOCK_SIZE)
+    {
+        // первый номер блока лежит в заголовке, в байтах - только число вхождений
+        blocks_.push_back({ ordinal, ordinal, static_cast<uint32_t>(bytes_.size()), 1 });
+    }
+    else
+    {
+        Block& block = blocks_.back();
+        WriteVarint(ordinal - block.last_ordinal);
+        block.last_ordinal = ordinal;
+        ++block.size;
+    }
+    WriteVarint(count);
+    ++size_;
+}
+
+bool CompressedPostings::Contains(uint32_t ordinal) const
+{
+    const size_t block_index = FindBlock(ordinal);
+    if (block_index == blocks_.size() || blocks_[block_index].first_ordinal > ordinal)
+    {
+        return false;
+    }
+
+    uint32_t ordinals[POSTINGS_BLOCK_SIZE];
+    uint32_t counts[POSTINGS_BLOCK_SIZE];
+    const size_t block_size = DecodeBlock(block_index, ordinals, counts);
+    return std::binary_search(ordinals, ordinals + block_size, ordinal);
+}
+
+size_t CompressedPostings::DecodeBlock(size_t block_index, uint32_t* ordinals, uint32_t* counts) const
+{
+    const Block& block = blocks_[block_index];
+    const uint8_t* data = bytes_.data() + block.offset;
+
+    const auto read_varint = [&data]()
+    {
+        uint32_t value = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            const uint8_t byte = *data++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (byte < 0x80)
+            {
+                return value;
+            }
+        }
+    };
+
+    uint32_t ordinal = block.first_ordinal;
+    for (size_t i = 0; i < block.size; ++i)
+    {
+        if (i > 0)
+        {
+            ordinal += read_varint();
+        }
+        ordinals[i] = ordinal;
+        counts[i] = read_varint();
+    }
+    return block.size;
+}
+
+size_t CompressedPostings::FindBlock(uint32_t ordinal) const
+{
+    const auto it = std::lower_bound(blocks_.begin(), blocks_.end(), ordinal, [](const Block& block, uint32_t value)
+    {
+        return block.last_ordinal < value;
+    });
+    return it - blocks_.begin();
+}
+
+size_t CompressedPostings::size() const
+{
+    return size_;
+}
+
+size_t CompressedPostings::GetBlockCount() const
+{
+    return blocks_.size();
+}
+
+const CompressedPostings::Block& CompressedPostings::GetBlock(size_t block_index) const
+{
+    return blocks_[block_index];
+}
+
+size_t CompressedPostings::GetMemoryUsage() const
+{
+    return blocks_.capacity() * sizeof(Block) + bytes_.capacity();
+}
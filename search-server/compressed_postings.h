@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const size_t POSTINGS_BLOCK_SIZE = 128;
+
+// Сжатый список вхождений: номера документов хранятся разностями, разности и число вхождений
+// слова в документ - в varint. Каждые POSTINGS_BLOCK_SIZE записей начинают новый блок, заголовок
+// которого позволяет пропускать блоки и декодировать их по одному.
+class CompressedPostings
+{
+public:
+    struct Block
+    {
+        uint32_t first_ordinal;
+        uint32_t last_ordinal;
+        uint32_t offset; // начало блока в bytes_
+        uint32_t size;
+    };
+
+private:
+    std::vector<Block> blocks_;
+    std::vector<uint8_t> bytes_;
+    size_t size_ = 0;
+
+    void WriteVarint(uint32_t value);
+
+public:
+    //------------------METHODS-----------------//
+    // ordinal должен быть больше всех уже добавленных
+    void Add(uint32_t ordinal, uint32_t count);
+    bool Contains(uint32_t ordinal) const;
+
+    // Раскладывает блок в ordinals и counts (не меньше POSTINGS_BLOCK_SIZE элементов), возвращает его размер.
+    size_t DecodeBlock(size_t block_index, uint32_t* ordinals, uint32_t* counts) const;
+    // Первый блок, в котором могут быть номера не меньше ordinal.
+    size_t FindBlock(uint32_t ordinal) const;
+
+    //------------------GETS-----------------//
+    size_t size() const;
+    size_t GetBlockCount() const;
+    const Block& GetBlock(size_t block_index) const;
+    size_t GetMemoryUsage() const;
+};
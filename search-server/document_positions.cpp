@@ -0,0 +1,75 @@
+#include "document_positions.h"
+
+#include <algorithm>
+#include <utility>
+
+DocumentPositions::DocumentPositions(const std::vector<TermId>& term_ids)
+{
+    // после сортировки позиции каждого слова идут подряд и по возрастанию
+    std::vector<std::pair<TermId, uint32_t>> occurrences;
+    occurrences.reserve(term_ids.size());
+    for (size_t position = 0; position < term_ids.size(); ++position)
+    {
+        occurrences.emplace_back(term_ids[position], static_cast<uint32_t>(position));
+    }
+    std::sort(occurrences.begin(), occurrences.end());
+
+    size_t term_count = 0;
+    for (size_t i = 0; i < occurrences.size(); ++i)
+    {
+        term_count += i == 0 || occurrences[i].first != occurrences[i - 1].first ? 1 : 0;
+    }
+    offsets_.reserve(term_count);
+    bytes_.reserve(occurrences.size());
+    for (size_t i = 0; i < occurrences.size(); ++i)
+    {
+        const bool is_first = i == 0 || occurrences[i].first != occurrences[i - 1].first;
+        if (is_first)
+        {
+            offsets_.push_back(static_cast<uint32_t>(bytes_.size()));
+        }
+
+        uint32_t value = is_first ? occurrences[i].second : occurrences[i].second - occurrences[i - 1].second;
+        while (value >= 0x80)
+        {
+            bytes_.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes_.push_back(static_cast<uint8_t>(value));
+    }
+}
+
+void DocumentPositions::Decode(size_t term_index, std::vector<uint32_t>& positions) const
+{
+    positions.clear();
+    const uint8_t* data = bytes_.data() + offsets_[term_index];
+    const uint8_t* const end = bytes_.data() + (term_index + 1 < offsets_.size() ? offsets_[term_index + 1] : bytes_.size());
+
+    uint32_t position = 0;
+    while (data != end)
+    {
+        uint32_t value = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            const uint8_t byte = *data++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (byte < 0x80)
+            {
+                break;
+            }
+        }
+        position = positions.empty() ? value : position + value;
+        positions.push_back(position);
+    }
+}
+
+void DocumentPositions::Clear()
+{
+    offsets_ = {};
+    bytes_ = {};
+}
+
+size_t DocumentPositions::GetMemoryUsage() const
+{
+    return offsets_.capacity() * sizeof(uint32_t) + bytes_.capacity();
+}
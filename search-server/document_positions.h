@@ -0,0 +1,30 @@
+#pragma once
+
+#include "term_dictionary.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Позиции слов одного документа для фраз и близости слов: номер слова среди слов документа без стоп-слов.
+// Для каждого различного слова, по возрастанию id, - разности его позиций в varint, подряд в одном буфере.
+class DocumentPositions
+{
+private:
+    std::vector<uint32_t> offsets_; // начало позиций i-го слова в bytes_
+    std::vector<uint8_t> bytes_;
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    DocumentPositions() = default;
+    // term_ids - id слов документа в порядке следования, с повторами
+    explicit DocumentPositions(const std::vector<TermId>& term_ids);
+
+    //------------------METHODS-----------------//
+    // Позиции term_index-го по возрастанию id слова документа, по возрастанию
+    void Decode(size_t term_index, std::vector<uint32_t>& positions) const;
+    void Clear();
+
+    //------------------GETS-----------------//
+    size_t GetMemoryUsage() const;
+};
@@ -0,0 +1,183 @@
+#include "index_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define INDEX_FILE_HAS_MMAP 1
+#endif
+
+using std::string_literals::operator""s;
+
+//------------------MappedFile-----------------------//
+
+#ifdef INDEX_FILE_HAS_MMAP
+
+MappedFile::MappedFile(const std::string& path)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open index file "s + path);
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Cannot read index file "s + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+
+    if (size_ > 0)
+    {
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Cannot map index file "s + path);
+        }
+        data_ = static_cast<const char*>(mapped);
+    }
+    close(fd); // отображение остаётся действительным и после закрытия файла
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        throw std::runtime_error("Cannot open index file "s + path);
+    }
+    buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+}
+
+MappedFile::~MappedFile()
+{
+}
+
+#endif
+
+const char* MappedFile::data() const
+{
+    return data_;
+}
+
+size_t MappedFile::size() const
+{
+    return size_;
+}
+
+//------------------IndexWriter-----------------------//
+
+IndexWriter::IndexWriter(const std::string& path)
+    : path_(path), temp_path_(path + ".tmp"s), out_(temp_path_, std::ios::binary | std::ios::trunc)
+{
+    if (!out_)
+    {
+        throw std::runtime_error("Cannot create index file "s + temp_path_);
+    }
+}
+
+IndexWriter::~IndexWriter()
+{
+    // запись не дошла до Finish: недописанный файл убирается, исходный остаётся как был
+    if (!finished_)
+    {
+        out_.close();
+        std::remove(temp_path_.c_str());
+    }
+}
+
+void IndexWriter::WriteString(std::string_view str)
+{
+    Write(static_cast<uint32_t>(str.size()));
+    out_.write(str.data(), str.size());
+    pos_ += str.size();
+}
+
+void IndexWriter::Align(size_t alignment)
+{
+    while (pos_ % alignment != 0)
+    {
+        out_.put('\0');
+        ++pos_;
+    }
+}
+
+void IndexWriter::Finish()
+{
+    out_.close();
+    if (!out_)
+    {
+        throw std::runtime_error("Cannot write index file "s + temp_path_);
+    }
+#ifndef INDEX_FILE_HAS_MMAP
+    // без POSIX rename не заменяет существующий файл
+    std::remove(path_.c_str());
+#endif
+    // отображение старого файла переживает rename: оно держит прежний inode
+    if (std::rename(temp_path_.c_str(), path_.c_str()) != 0)
+    {
+        throw std::runtime_error("Cannot replace index file "s + path_);
+    }
+    finished_ = true;
+}
+
+//------------------IndexReader-----------------------//
+
+IndexReader::IndexReader(const char* data, size_t size)
+    : data_(data), size_(size){}
+
+void IndexReader::Require(size_t byte_count) const
+{
+    if (byte_count > size_ - pos_)
+    {
+        throw std::invalid_argument("Index file is truncated"s);
+    }
+}
+
+void IndexReader::RequireArray(size_t count, size_t element_size) const
+{
+    // число элементов берётся из файла, произведение не должно переполниться
+    if (count > std::numeric_limits<size_t>::max() / element_size)
+    {
+        throw std::invalid_argument("Index file is corrupted"s);
+    }
+    Require(count * element_size);
+}
+
+std::string_view IndexReader::ReadString()
+{
+    const uint32_t length = Read<uint32_t>();
+    Require(length);
+    const std::string_view str(data_ + pos_, length);
+    pos_ += length;
+    return str;
+}
+
+void IndexReader::Align(size_t alignment)
+{
+    const size_t padding = (alignment - pos_ % alignment) % alignment;
+    Require(padding);
+    pos_ += padding;
+}
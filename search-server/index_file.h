@@ -0,0 +1,121 @@
+#pragma once
+
+#include "array_view.h"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Формат файла индекса (SearchServer::SaveIndex / LoadIndex). Все числа - в порядке байт машины.
+const char INDEX_FILE_MAGIC[8] = {'S', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+const uint32_t INDEX_FILE_VERSION = 3; // 2: число слов документа для сжатых списков; 3: выровненные term_ids документов
+
+// Файл, отображённый в память только для чтения. Там, где mmap нет, файл читается целиком.
+class MappedFile
+{
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<char> buffer_;
+
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const;
+    size_t size() const;
+};
+
+// Пишет во временный файл рядом с path и заменяет им path в Finish. Старый файл до этого не трогается,
+// поэтому сохранять можно и в файл, из которого индекс отображён в память.
+class IndexWriter
+{
+private:
+    std::string path_;
+    std::string temp_path_;
+    std::ofstream out_;
+    uint64_t pos_ = 0;
+    bool finished_ = false;
+
+public:
+    explicit IndexWriter(const std::string& path);
+    ~IndexWriter();
+
+    IndexWriter(const IndexWriter&) = delete;
+    IndexWriter& operator=(const IndexWriter&) = delete;
+
+    template <typename T>
+    void Write(const T& value);
+    template <typename T>
+    void WriteArray(ArrayView<T> values);
+    void WriteString(std::string_view str);
+    void Align(size_t alignment);
+    void Finish();
+};
+
+// Последовательное чтение из отображённого файла с проверкой границ.
+class IndexReader
+{
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+
+    void Require(size_t byte_count) const;
+    void RequireArray(size_t count, size_t element_size) const;
+
+public:
+    IndexReader(const char* data, size_t size);
+
+    template <typename T>
+    T Read();
+    // массив не копируется: возвращается взгляд прямо в файл, поэтому он должен быть выровнен под T
+    template <typename T>
+    ArrayView<T> ReadArray(size_t count);
+    std::string_view ReadString();
+    void Align(size_t alignment);
+};
+
+template <typename T>
+void IndexWriter::Write(const T& value)
+{
+    out_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    pos_ += sizeof(T);
+}
+
+template <typename T>
+void IndexWriter::WriteArray(ArrayView<T> values)
+{
+    out_.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    pos_ += values.size() * sizeof(T);
+}
+
+template <typename T>
+T IndexReader::Read()
+{
+    Require(sizeof(T));
+    T value;
+    std::copy(data_ + pos_, data_ + pos_ + sizeof(T), reinterpret_cast<char*>(&value));
+    pos_ += sizeof(T);
+    return value;
+}
+
+template <typename T>
+ArrayView<T> IndexReader::ReadArray(size_t count)
+{
+    RequireArray(count, sizeof(T));
+    if (reinterpret_cast<uintptr_t>(data_ + pos_) % alignof(T) != 0)
+    {
+        throw std::invalid_argument("Index file has misaligned array");
+    }
+    const T* values = reinterpret_cast<const T*>(data_ + pos_);
+    pos_ += count * sizeof(T);
+    return { values, count };
+}
@@ -42,6 +42,28 @@ string GenerateQuery(mt19937& generator, const vector<string>& dictionary, int w
     }
     return query;
 }
+// Слова с частотами по закону Ципфа, как в живых текстах: i-е слово словаря встречается пропорционально 1 / (i + 1)
+vector<string> GenerateZipfTexts(mt19937& generator, const vector<string>& dictionary, int text_count, int min_word_count, int max_word_count) {
+    vector<double> weights(dictionary.size());
+    for (size_t i = 0; i < weights.size(); ++i) {
+        weights[i] = 1.0 / (i + 1);
+    }
+    discrete_distribution<size_t> word_index(weights.begin(), weights.end());
+    vector<string> texts;
+    texts.reserve(text_count);
+    for (int i = 0; i < text_count; ++i) {
+        string text;
+        const int word_count = uniform_int_distribution(min_word_count, max_word_count)(generator);
+        for (int j = 0; j < word_count; ++j) {
+            if (!text.empty()) {
+                text.push_back(' ');
+            }
+            text += dictionary[word_index(generator)];
+        }
+        texts.push_back(move(text));
+    }
+    return texts;
+}
 vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count, int max_word_count) {
     vector<string> queries;
     queries.reserve(query_count);
@@ -62,13 +84,73 @@ void Test(string_view mark, const SearchServer& search_server, const vector<stri
     cout << total_relevance << endl;
 }
 #define TEST(policy) Test(#policy, search_server, queries, execution::policy)
+void BenchmarkPostingsFormats(SearchServer search_server, const vector<string>& queries) {
+    for (const PostingsFormat format : {PostingsFormat::PLAIN, PostingsFormat::COMPRESSED}) {
+        search_server.SetPostingsFormat(format);
+        const string mark = format == PostingsFormat::PLAIN ? "plain postings"s : "compressed postings"s;
+        cout << mark << ": "s << search_server.GetPostingsMemoryUsage() << " bytes"s << endl;
+        Test(mark, search_server, queries, execution::seq);
+        Test(mark + " par"s, search_server, queries, execution::par);
+    }
+}
+template <typename ScoringPolicy>
+void TestScoring(string_view mark, const SearchServer& search_server, const vector<string>& queries) {
+    LOG_DURATION(mark);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments<ScoringPolicy>(query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+template <typename ScoringPolicy>
+void TestScoringScratch(string_view mark, const SearchServer& search_server, const vector<string>& queries) {
+    SearchServer::QueryScratch scratch;
+    LOG_DURATION(mark);
+    double total_relevance = 0;
+    for (const string_view query : queries) {
+        for (const auto& document : search_server.FindTopDocuments<ScoringPolicy>(scratch, query)) {
+            total_relevance += document.relevance;
+        }
+    }
+    cout << total_relevance << endl;
+}
+// TF-IDF идёт тем же шаблонным путём, что и BM25, и должен считаться не медленнее прежнего.
+// Без QueryScratch время уходит в основном на std::map релевантностей, цена формулы видна в замере со scratch.
+void BenchmarkScoringPolicies(SearchServer search_server, const vector<string>& queries) {
+    for (const QueryEvaluation evaluation : {QueryEvaluation::EXHAUSTIVE, QueryEvaluation::WAND}) {
+        search_server.SetQueryEvaluation(evaluation);
+        const string mark = evaluation == QueryEvaluation::WAND ? " wand"s : " exhaustive"s;
+        TestScoring<TfIdfScoring>("tf-idf"s + mark, search_server, queries);
+        TestScoringScratch<TfIdfScoring>("tf-idf"s + mark + " scratch"s, search_server, queries);
+        TestScoring<Bm25Scoring>("bm25"s + mark, search_server, queries);
+        TestScoringScratch<Bm25Scoring>("bm25"s + mark + " scratch"s, search_server, queries);
+    }
+}
+// WAND пропускает документы, только когда вклады слов сильно различаются: короткие запросы по текстам
+// с частотами по закону Ципфа. На равномерных запросах из 70 слов (BenchmarkScoringPolicies) он медленнее.
+void BenchmarkQueryEvaluation(mt19937& generator, const vector<string>& dictionary) {
+    SearchServer search_server("and with"s);
+    const auto documents = GenerateZipfTexts(generator, dictionary, 20'000, 20, 200);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, {1, 2, 3});
+    }
+    const auto queries = GenerateZipfTexts(generator, dictionary, 1'000, 1, 3);
+    for (const QueryEvaluation evaluation : {QueryEvaluation::EXHAUSTIVE, QueryEvaluation::WAND}) {
+        search_server.SetQueryEvaluation(evaluation);
+        const string mark = evaluation == QueryEvaluation::WAND ? "zipf wand"s : "zipf exhaustive"s;
+        TestScoring<TfIdfScoring>(mark, search_server, queries);
+        TestScoringScratch<TfIdfScoring>(mark + " scratch"s, search_server, queries);
+    }
+}
 void PrintDocument2(const Document& document) {
     cout << "{ "s
          << "document_id = "s << document.id << ", "s
          << "relevance = "s << document.relevance << ", "s
          << "rating = "s << document.rating << " }"s << endl;
 }
-int main() {
+int main(int argc, char* argv[]) {
     SearchServer search_server("and with"s);
     int id = 0;
     for (
@@ -108,6 +190,14 @@ int main() {
     TEST(seq);
     TEST(par);
 
+    // остальные замеры долгие, поэтому только по флагу: main --benchmark.
+    // Сервер передаётся копией: замеры переключают формат списков и способ вычисления
+    if (argc > 1 && argv[1] == "--benchmark"s) {
+        BenchmarkPostingsFormats(search_server2, queries);
+        BenchmarkScoringPolicies(search_server2, queries);
+        BenchmarkQueryEvaluation(generator, dictionary);
+    }
+
     return 0;
 }
 //int main() {
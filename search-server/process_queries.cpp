@@ -1,5 +1,6 @@
 #include "process_queries.h"
-#include <list>
+#include <atomic>
+#include <exception>
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server,
     const std::vector<std::string>& queries)
 {
@@ -12,16 +13,183 @@ std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_ser
    return doc_to_return;
 }
 
-std::list<Document> ProcessQueriesJoined(const SearchServer &search_server, const std::vector<std::string> &queries)
+std::vector<std::vector<Document>> ProcessQueries(QueryResultCache& cache, const std::vector<std::string>& queries)
 {
-    std::list<Document> doc_to_return;
+    std::vector<std::vector<Document>> documents(queries.size());
+    std::transform(std::execution::par, queries.begin(), queries.end(), documents.begin(), [&cache](const std::string& query)
+    {
+        return cache.FindTopDocuments(query);
+    });
+    return documents;
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer &search_server, const std::vector<std::string> &queries)
+{
+    return JoinedDocuments(search_server, queries);
+}
+
+//------------------JoinedDocuments-----------------//
+
+JoinedDocuments::JoinedDocuments(const SearchServer& search_server, const std::vector<std::string>& queries, size_t batch_size)
+    : search_server_(search_server)
+    , queries_(queries)
+    , batch_size_(batch_size)
+{
+    if (batch_size_ == 0)
+    {
+        // несколько запросов на поток, чтобы порция загружала все ядра
+        batch_size_ = std::max<size_t>(std::thread::hardware_concurrency(), 1) * 16;
+    }
+}
+
+bool JoinedDocuments::LoadNextBatch()
+{
+    if (next_query_ >= queries_.size())
+    {
+        return false;
+    }
+    const size_t count = std::min(batch_size_, queries_.size() - next_query_);
+    const auto first = queries_.begin() + next_query_;
 
-    for (auto & documents : ProcessQueries(search_server, queries))
+    // результаты новой порции заменяют предыдущую, в памяти держится только одна порция
+    batch_.resize(count);
+    std::transform(std::execution::par, first, first + count, batch_.begin(), [this](const std::string& str)
+    {
+        return search_server_.FindTopDocuments(str);
+    });
+
+    next_query_ += count;
+    query_in_batch_ = 0;
+    document_in_query_ = 0;
+    return true;
+}
+
+bool JoinedDocuments::SkipExhaustedQueries()
+{
+    while (true)
     {
-        for (auto & document : documents)
+        while (query_in_batch_ < batch_.size() && document_in_query_ >= batch_[query_in_batch_].size())
         {
-            doc_to_return.push_back(std::move(document));
+            ++query_in_batch_;
+            document_in_query_ = 0;
+        }
+        if (query_in_batch_ < batch_.size())
+        {
+            return true;
+        }
+        if (!LoadNextBatch())
+        {
+            return false;
         }
     }
+}
+
+JoinedDocuments::Iterator JoinedDocuments::begin()
+{
+    return SkipExhaustedQueries() ? Iterator(this) : end();
+}
+
+JoinedDocuments::Iterator JoinedDocuments::end()
+{
+    return Iterator();
+}
+
+JoinedDocuments::Iterator::Iterator(JoinedDocuments* owner)
+    : owner_(owner)
+{
+}
+
+JoinedDocuments::Iterator::reference JoinedDocuments::Iterator::operator*() const
+{
+    return owner_->batch_[owner_->query_in_batch_][owner_->document_in_query_];
+}
+
+JoinedDocuments::Iterator::pointer JoinedDocuments::Iterator::operator->() const
+{
+    return &**this;
+}
+
+JoinedDocuments::Iterator& JoinedDocuments::Iterator::operator++()
+{
+    ++owner_->document_in_query_;
+    if (!owner_->SkipExhaustedQueries())
+    {
+        owner_ = nullptr;
+    }
+    return *this;
+}
+
+void JoinedDocuments::Iterator::operator++(int)
+{
+    ++*this;
+}
+
+bool JoinedDocuments::Iterator::operator==(const Iterator& other) const
+{
+    return owner_ == other.owner_;
+}
+
+bool JoinedDocuments::Iterator::operator!=(const Iterator& other) const
+{
+    return !(*this == other);
+}
+
+//------------------BatchQueryExecutor-----------------//
+
+BatchQueryExecutor::BatchQueryExecutor(const SearchServer& search_server, size_t thread_count)
+    : search_server_(search_server)
+    , thread_pool_(std::max<size_t>(thread_count, 1))
+    , scratches_(thread_pool_.GetThreadCount())
+{
+}
+
+std::vector<std::vector<Document>> BatchQueryExecutor::ProcessQueries(const std::vector<std::string>& queries, DocumentStatus status, size_t max_count)
+{
+    std::lock_guard<std::mutex> guard(m_);
+    std::vector<std::vector<Document>> doc_to_return(queries.size());
+    std::atomic<size_t> next_query = 0;
+
+    // по одной задаче на поток: каждая работает со своими буферами и берёт следующий запрос из общего счётчика
+    std::vector<std::future<void>> workers;
+    const size_t worker_count = std::min(scratches_.size(), std::max<size_t>(queries.size(), 1));
+    workers.reserve(worker_count);
+    for (size_t worker = 0; worker < worker_count; ++worker)
+    {
+        workers.push_back(thread_pool_.Submit([this, &queries, &doc_to_return, &next_query, status, max_count, worker]()
+        {
+            SearchServer::QueryScratch& scratch = scratches_[worker];
+            for (size_t i = next_query++; i < queries.size(); i = next_query++)
+            {
+                doc_to_return[i] = search_server_.FindTopDocuments(scratch, queries[i], status, max_count);
+            }
+        }));
+    }
+
+    // дожидаемся всех задач, прежде чем пробрасывать исключение: они ссылаются на локальные переменные
+    std::exception_ptr error;
+    for (auto& result : workers)
+    {
+        try
+        {
+            result.get();
+        }
+        catch (...)
+        {
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
     return doc_to_return;
 }
+
+size_t BatchQueryExecutor::GetThreadCount() const
+{
+    return thread_pool_.GetThreadCount();
+}
@@ -4,10 +4,110 @@
 #include <functional>
 #include <execution>
 #include <vector>
-#include <list>
+#include <iterator>
+#include <mutex>
+#include <thread>
 
 #include "search_server.h"
+#include "thread_pool.h"
+#include "query_result_cache.h"
+// Ленивый диапазон документов всех запросов подряд, в порядке запросов. Запросы обрабатываются
+// параллельно порциями по мере чтения, поэтому в памяти держится только текущая порция результатов,
+// а первые документы доступны до окончания всего пакета. Вектор queries должен жить дольше диапазона,
+// поэтому временный вектор запросов не принимается.
+class JoinedDocuments
+{
+public:
+    class Iterator
+    {
+    private:
+        JoinedDocuments* owner_ = nullptr;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        //------------------CONSTRUCTORS-----------------//
+        Iterator() = default;
+        explicit Iterator(JoinedDocuments* owner);
+
+        //------------------OPERATORS-----------------//
+        reference operator*() const;
+        pointer operator->() const;
+        Iterator& operator++();
+        void operator++(int);
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const;
+    };
+
+private:
+    const SearchServer& search_server_;
+    const std::vector<std::string>& queries_;
+    size_t batch_size_;
+    size_t next_query_ = 0;
+    std::vector<std::vector<Document>> batch_;
+    size_t query_in_batch_ = 0;
+    size_t document_in_query_ = 0;
+
+    bool LoadNextBatch();
+    bool SkipExhaustedQueries();
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    JoinedDocuments(const SearchServer& search_server, const std::vector<std::string>& queries, size_t batch_size = 0);
+    JoinedDocuments(const SearchServer& search_server, std::vector<std::string>&& queries, size_t batch_size = 0) = delete;
+
+    JoinedDocuments(const JoinedDocuments&) = delete;
+    JoinedDocuments& operator=(const JoinedDocuments&) = delete;
+    JoinedDocuments(JoinedDocuments&&) = default;
+
+    //------------------ITERATORS-----------------//
+    // Диапазон однопроходный: begin() продолжает с текущей позиции
+    Iterator begin();
+    Iterator end();
+};
+
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
-std::list<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+// То же через кеш результатов: повторяющиеся запросы пакета и прошлых пакетов не пересчитываются
+std::vector<std::vector<Document>> ProcessQueries(QueryResultCache& cache, const std::vector<std::string>& queries);
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, std::vector<std::string>&& queries) = delete;
+
+// Передаёт документы всех запросов в sink по мере готовности, в порядке запросов. Диапазон не выходит
+// из функции, поэтому queries может быть и временным.
+template <typename DocumentSink>
+void ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries, DocumentSink sink)
+{
+    for (const Document& document : JoinedDocuments(search_server, queries))
+    {
+        sink(document);
+    }
+}
+
+// Пакетное выполнение запросов на постоянных потоках. У каждого потока свои буферы поиска,
+// которые переживают запросы и пакеты, поэтому память на накопление релевантности не выделяется заново.
+// Результаты возвращаются в порядке запросов. Пакеты из разных потоков выполняются по очереди:
+// все они идут через одни и те же буферы.
+class BatchQueryExecutor
+{
+private:
+    const SearchServer& search_server_;
+    ThreadPool thread_pool_;
+    std::mutex m_; // один пакет за раз владеет scratches_
+    std::vector<SearchServer::QueryScratch> scratches_;
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    explicit BatchQueryExecutor(const SearchServer& search_server, size_t thread_count = std::thread::hardware_concurrency());
+
+    //------------------METHODS-----------------//
+    std::vector<std::vector<Document>> ProcessQueries(const std::vector<std::string>& queries, DocumentStatus status = DocumentStatus::ACTUAL, size_t max_count = MAX_RESULT_DOCUMENT_COUNT);
+
+    //------------------GETS-----------------//
+    size_t GetThreadCount() const;
+};
 
 #endif // PROCESS_QUERIES_H
@@ -0,0 +1,219 @@
+#include "query_result_cache.h"
+
+//------------------Key-----------------------//
+
+bool QueryResultCache::Key::operator==(const Key& other) const
+{
+    return status == other.status && max_count == other.max_count && plus_terms == other.plus_terms && minus_terms == other.minus_terms
+        && required_terms == other.required_terms && phrases == other.phrases && has_unknown_required_word == other.has_unknown_required_word;
+}
+
+size_t QueryResultCache::KeyHash::operator()(const Key& key) const
+{
+    uint64_t hash = static_cast<uint64_t>(key.status) * 0x9E3779B97F4A7C15ull + key.max_count;
+    const auto combine = [&hash](uint64_t value)
+    {
+        hash = (hash ^ value) * 0x100000001B3ull;
+        hash ^= hash >> 29;
+    };
+    for (const TermId term_id : key.plus_terms)
+    {
+        combine(term_id);
+    }
+    // граница между плюс- и минус-словами, иначе {1}{2} и {1, 2}{} совпали бы
+    combine(0xFFFFFFFFFFull);
+    for (const TermId term_id : key.minus_terms)
+    {
+        combine(term_id);
+    }
+    combine(0xFFFFFFFFFDull);
+    for (const TermId term_id : key.required_terms)
+    {
+        combine(term_id);
+    }
+    for (const std::vector<TermId>& phrase : key.phrases)
+    {
+        combine(0xFFFFFFFFFEull);
+        for (const TermId term_id : phrase)
+        {
+            combine(term_id);
+        }
+    }
+    combine(key.has_unknown_required_word);
+    return static_cast<size_t>(hash * 0xBF58476D1CE4E5B9ull);
+}
+
+//------------------FrequencySketch-----------------------//
+
+QueryResultCache::FrequencySketch::FrequencySketch(size_t capacity)
+    : sample_limit_(10 * capacity)
+{
+    size_t row_size = 16;
+    while (row_size < 4 * capacity)
+    {
+        row_size *= 2;
+    }
+    counters_.resize(4 * row_size);
+    row_mask_ = row_size - 1;
+}
+
+size_t QueryResultCache::FrequencySketch::GetIndex(uint64_t hash, size_t row) const
+{
+    static const uint64_t seeds[] = { 0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull };
+    const uint64_t mixed = (hash + seeds[row]) * seeds[(row + 1) % 4];
+    return row * (row_mask_ + 1) + ((mixed >> 32) & row_mask_);
+}
+
+void QueryResultCache::FrequencySketch::Increment(uint64_t hash)
+{
+    for (size_t row = 0; row < 4; ++row)
+    {
+        uint8_t& counter = counters_[GetIndex(hash, row)];
+        if (counter < 15)
+        {
+            ++counter;
+        }
+    }
+
+    if (++sample_count_ >= sample_limit_)
+    {
+        for (uint8_t& counter : counters_)
+        {
+            counter /= 2;
+        }
+        sample_count_ /= 2;
+    }
+}
+
+uint8_t QueryResultCache::FrequencySketch::Estimate(uint64_t hash) const
+{
+    uint8_t estimate = 15;
+    for (size_t row = 0; row < 4; ++row)
+    {
+        estimate = std::min(estimate, counters_[GetIndex(hash, row)]);
+    }
+    return estimate;
+}
+
+//------------------constructors-----------------------//
+
+QueryResultCache::Shard::Shard(size_t capacity)
+    : sketch(capacity)
+{
+}
+
+QueryResultCache::QueryResultCache(const SearchServer& search_server, size_t capacity)
+    : search_server_(search_server)
+{
+    if (capacity == 0)
+    {
+        throw std::invalid_argument("Cache capacity must be positive");
+    }
+
+    const size_t shard_count = std::min(capacity, QUERY_CACHE_SHARD_COUNT);
+    shard_capacity_ = (capacity + shard_count - 1) / shard_count;
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        shards_.emplace_back(shard_capacity_);
+    }
+}
+
+//--------------------private methods------------------//
+
+void QueryResultCache::Insert(Shard& shard, Key key, uint64_t hash, uint64_t generation, const std::vector<Document>& documents)
+{
+    std::lock_guard<std::mutex> guard(shard.m);
+    if (shard.entries.count(key) > 0)
+    {
+        // тот же запрос успел посчитать другой поток
+        return;
+    }
+
+    if (shard.entries.size() >= shard_capacity_)
+    {
+        const auto victim = shard.entries.find(*shard.recency.back());
+        // устаревшая запись уходит всегда, живая - только ради более частого запроса
+        if (victim->second.generation == generation && shard.sketch.Estimate(hash) <= shard.sketch.Estimate(KeyHash{}(victim->first)))
+        {
+            return;
+        }
+        shard.recency.pop_back();
+        shard.entries.erase(victim);
+    }
+
+    const auto it = shard.entries.emplace(std::move(key), Entry{ generation, documents, {} }).first;
+    shard.recency.push_front(&it->first);
+    it->second.position = shard.recency.begin();
+}
+
+//--------------------public methods------------------//
+
+std::vector<Document> QueryResultCache::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t max_count)
+{
+    const SearchServer::Query query = search_server_.ParseQuery(raw_query);
+    Key key{ status, max_count, query.plus_terms, query.minus_terms, query.required_terms, query.phrases, query.has_unknown_required_word };
+    std::sort(key.plus_terms.begin(), key.plus_terms.end());
+    std::sort(key.minus_terms.begin(), key.minus_terms.end());
+
+    const uint64_t hash = KeyHash{}(key);
+    Shard& shard = shards_[hash % shards_.size()];
+    const uint64_t generation = search_server_.GetGeneration();
+    {
+        std::lock_guard<std::mutex> guard(shard.m);
+        shard.sketch.Increment(hash);
+        const auto it = shard.entries.find(key);
+        if (it != shard.entries.end())
+        {
+            if (it->second.generation == generation)
+            {
+                shard.recency.splice(shard.recency.begin(), shard.recency, it->second.position);
+                ++hit_count_;
+                return it->second.documents;
+            }
+            shard.recency.erase(it->second.position);
+            shard.entries.erase(it);
+        }
+    }
+    ++miss_count_;
+
+    // запрос уже разобран, поэтому поиск идёт мимо FindTopDocuments
+    std::vector<Document> documents = search_server_.FindAllDocuments(std::execution::seq, query, [status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
+    {
+        return document_status == status;
+    });
+    SearchServer::SelectTopDocuments(std::execution::seq, documents, max_count);
+
+    Insert(shard, std::move(key), hash, generation, documents);
+    return documents;
+}
+
+void QueryResultCache::Clear()
+{
+    for (Shard& shard : shards_)
+    {
+        std::lock_guard<std::mutex> guard(shard.m);
+        shard.entries.clear();
+        shard.recency.clear();
+    }
+}
+
+uint64_t QueryResultCache::GetHitCount() const
+{
+    return hit_count_;
+}
+
+uint64_t QueryResultCache::GetMissCount() const
+{
+    return miss_count_;
+}
+
+size_t QueryResultCache::GetSize() const
+{
+    size_t size = 0;
+    for (const Shard& shard : shards_)
+    {
+        std::lock_guard<std::mutex> guard(shard.m);
+        size += shard.entries.size();
+    }
+    return size;
+}
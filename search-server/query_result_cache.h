@@ -0,0 +1,103 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+const size_t DEFAULT_QUERY_CACHE_CAPACITY = 4096;
+const size_t QUERY_CACHE_SHARD_COUNT = 16;
+
+// Кеш результатов FindTopDocuments для частых запросов. Ключ - разобранный запрос: id плюс- и минус-слов
+// без стоп-слов и повторов, по возрастанию, вместе со статусом и max_count, поэтому "кот пёс" и
+// "пёс  кот кот" попадают в одну запись. Запись хранит поколение индекса и после AddDocument /
+// RemoveDocument считается промахом. Память ограничена числом записей: при заполнении вытесняется
+// давно не использованная запись (LRU), но только если новый запрос встречался чаще неё (TinyLFU),
+// чтобы редкие запросы не вымывали частые. Методы потокобезопасны; сервер нельзя менять во время запросов.
+class QueryResultCache
+{
+private:
+    struct Key
+    {
+        DocumentStatus status;
+        size_t max_count;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+        std::vector<TermId> required_terms; // +слова, а при QueryOperator::AND - все плюс-слова
+        std::vector<std::vector<TermId>> phrases; // фразы в кавычках, в порядке запроса
+        bool has_unknown_required_word;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry
+    {
+        uint64_t generation;
+        std::vector<Document> documents;
+        std::list<const Key*>::iterator position;
+    };
+
+    // Приблизительные частоты запросов: 4 строки счётчиков, оценка - минимум. Счётчики насыщаются
+    // на 15 и делятся пополам после sample_limit_ обращений, поэтому старая популярность забывается.
+    class FrequencySketch
+    {
+    private:
+        std::vector<uint8_t> counters_;
+        size_t row_mask_;
+        size_t sample_count_ = 0;
+        size_t sample_limit_;
+
+        size_t GetIndex(uint64_t hash, size_t row) const;
+
+    public:
+        explicit FrequencySketch(size_t capacity);
+
+        void Increment(uint64_t hash);
+        uint8_t Estimate(uint64_t hash) const;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex m;
+        std::unordered_map<Key, Entry, KeyHash> entries;
+        std::list<const Key*> recency; // от недавних к давним
+        FrequencySketch sketch;
+
+        explicit Shard(size_t capacity);
+    };
+
+    const SearchServer& search_server_;
+    size_t shard_capacity_;
+    std::deque<Shard> shards_; // deque: мьютекс не перемещается
+    std::atomic<uint64_t> hit_count_ = 0;
+    std::atomic<uint64_t> miss_count_ = 0;
+
+    void Insert(Shard& shard, Key key, uint64_t hash, uint64_t generation, const std::vector<Document>& documents);
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    // capacity - сколько результатов запросов хранится одновременно
+    explicit QueryResultCache(const SearchServer& search_server, size_t capacity = DEFAULT_QUERY_CACHE_CAPACITY);
+
+    QueryResultCache(const QueryResultCache&) = delete;
+    QueryResultCache& operator=(const QueryResultCache&) = delete;
+
+    //------------------METHODS-----------------//
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t max_count = MAX_RESULT_DOCUMENT_COUNT);
+    void Clear();
+
+    //------------------GETS-----------------//
+    uint64_t GetHitCount() const;
+    uint64_t GetMissCount() const;
+    size_t GetSize() const;
+};
@@ -8,3 +8,38 @@
 #include <iostream>
 
 void RemoveDuplicates(SearchServer& search_server);
+
+// Дубликаты ищутся по подписям наборов слов (параллельно при policy = par) и удаляются одной пачкой
+template <typename ExecutionPolicy>
+void RemoveDuplicates(const ExecutionPolicy& policy, SearchServer& search_server)
+{
+    const std::vector<int> duplicates = search_server.FindDuplicates(policy);
+    for (const int document_id : duplicates)
+    {
+        std::cout << "Found duplicates removed " << document_id << '\n';
+    }
+    std::cout.flush();
+
+    search_server.RemoveDocuments(policy, duplicates);
+}
+
+void RemoveNearDuplicates(SearchServer& search_server, const NearDuplicateOptions& options = {});
+
+// Из каждого кластера почти дубликатов остаётся документ с наименьшим id, остальные удаляются одной пачкой
+template <typename ExecutionPolicy>
+void RemoveNearDuplicates(const ExecutionPolicy& policy, SearchServer& search_server, const NearDuplicateOptions& options = {})
+{
+    std::vector<int> duplicates;
+    for (const std::vector<int>& cluster : search_server.FindNearDuplicates(policy, options))
+    {
+        duplicates.insert(duplicates.end(), std::next(cluster.begin()), cluster.end());
+    }
+    std::sort(duplicates.begin(), duplicates.end());
+    for (const int document_id : duplicates)
+    {
+        std::cout << "Found near duplicates removed " << document_id << '\n';
+    }
+    std::cout.flush();
+
+    search_server.RemoveDocuments(policy, duplicates);
+}
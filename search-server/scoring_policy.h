@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Статистика коллекции на момент запроса, по ней политика подсчёта релевантности настраивает себя
+struct ScoringStatistics
+{
+    size_t document_count = 0;
+    double log_document_count = 0.0;
+    double average_document_length = 0.0; // в словах без стоп-слов
+};
+
+// Статистика по числу живых документов и их суммарной длине. Через неё и ComputeLogDocumentFreq
+// считают и один SearchServer, и серверы из нескольких индексов со статистикой по всей коллекции.
+inline ScoringStatistics MakeScoringStatistics(size_t document_count, uint64_t total_word_count)
+{
+    return { document_count, std::log(static_cast<double>(document_count)),
+             document_count > 0 ? static_cast<double>(total_word_count) / document_count : 0.0 };
+}
+
+inline double ComputeLogDocumentFreq(size_t document_freq)
+{
+    return document_freq == 0 ? 0.0 : std::log(static_cast<double>(document_freq));
+}
+
+// Политика подсчёта релевантности - параметр шаблона FindTopDocuments. Объект создаётся на запрос
+// из ScoringStatistics, методы встраиваются прямо в цикл по вхождениям, без виртуальных вызовов.
+// Своя политика должна иметь такой же конструктор и методы:
+//   ComputeInverseDocumentFreq(document_freq, log_document_freq) - вес слова по числу документов с ним;
+//   Score(term_freq, length_norm, inverse_document_freq) - вклад слова в документ, где term_freq - доля
+//       вхождений слова среди слов документа, length_norm - 1 / длина документа;
+//   GetMaxScore(max_term_freq, inverse_document_freq) - не меньше Score любого документа с term_freq
+//       не больше max_term_freq. По ней WAND пропускает документы, поэтому Score не должна убывать по term_freq.
+class TfIdfScoring
+{
+private:
+    double log_document_count_;
+
+public:
+    explicit TfIdfScoring(const ScoringStatistics& statistics)
+        : log_document_count_(statistics.log_document_count){}
+
+    double ComputeInverseDocumentFreq([[__maybe_unused__]]size_t document_freq, double log_document_freq) const
+    {
+        return log_document_count_ - log_document_freq;
+    }
+    double Score(double term_freq, [[__maybe_unused__]]double length_norm, double inverse_document_freq) const
+    {
+        return term_freq * inverse_document_freq;
+    }
+    double GetMaxScore(double max_term_freq, double inverse_document_freq) const
+    {
+        return max_term_freq * inverse_document_freq;
+    }
+};
+
+// Okapi BM25: повторы слова дают всё меньший прирост (K1), длинные документы штрафуются (B).
+// С числом вхождений count и длиной len вклад idf * count * (K1 + 1) / (count + K1 * (1 - B + B * len / avgdl));
+// здесь числитель и знаменатель поделены на len, чтобы считать по TF из списков вхождений.
+// IDF = log(1 + (N - df + 0.5) / (df + 0.5)) не бывает отрицательным даже у слов из большинства документов.
+class Bm25Scoring
+{
+private:
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+
+    double document_count_;
+    double average_length_weight_; // K1 * B / avgdl
+
+public:
+    explicit Bm25Scoring(const ScoringStatistics& statistics)
+        : document_count_(static_cast<double>(statistics.document_count)),
+          average_length_weight_(statistics.average_document_length > 0.0 ? K1 * B / statistics.average_document_length : 0.0){}
+
+    double ComputeInverseDocumentFreq(size_t document_freq, [[__maybe_unused__]]double log_document_freq) const
+    {
+        return std::log(1.0 + (document_count_ - document_freq + 0.5) / (document_freq + 0.5));
+    }
+    double Score(double term_freq, double length_norm, double inverse_document_freq) const
+    {
+        return inverse_document_freq * (K1 + 1.0) * term_freq / (term_freq + K1 * (1.0 - B) * length_norm + average_length_weight_);
+    }
+    // слагаемое с length_norm в знаменателе не меньше нуля, без него вклад только больше
+    double GetMaxScore(double max_term_freq, double inverse_document_freq) const
+    {
+        return inverse_document_freq * (K1 + 1.0) * max_term_freq / (max_term_freq + average_length_weight_);
+    }
+};
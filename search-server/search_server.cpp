@@ -2,106 +2,1068 @@
 
 using std::string_literals::operator""s;
 
+namespace
+{
+    // Первый индекс из [first, last), для которого is_before ложно. Шаги 1, 2, 4... от first, затем
+    // двоичный поиск в найденном отрезке: короткий прыжок курсора стоит O(log прыжка), а не O(log длины списка)
+    template <typename IsBefore>
+    size_t GallopSearch(size_t first, size_t last, IsBefore is_before)
+    {
+        if (first == last || !is_before(first))
+        {
+            return first;
+        }
+        size_t low = first;
+        size_t step = 1;
+        while (low + step < last && is_before(low + step))
+        {
+            low += step;
+            step *= 2;
+        }
+        size_t high = std::min(low + step, last);
+        ++low;
+        while (low < high)
+        {
+            const size_t middle = low + (high - low) / 2;
+            if (is_before(middle))
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        return low;
+    }
+}
+
 //------------------constructors-----------------------//
 
-SearchServer::SearchServer(const std::string& stop_words)
+SearchServer::SearchServer(const std::string& stop_words)
+{
+    SetStopWords(SplitIntoWords(stop_words));
+}
+
+SearchServer::SearchServer(std::string_view stop_words)
+{
+    SetStopWords(SplitIntoWords(stop_words));
+}
+
+//--------------------private methods------------------//
+
+bool SearchServer::IsStopWord(const std::string_view& word) const
+{
+    return stop_words_.count(word) > 0;
+}
+
+bool SearchServer::IsValidWord(const std::string_view& word) const
+{
+    return std::none_of(word.begin(), word.end(), [](char c)
+    {
+        return c >= '\0' && c < ' ';
+    });
+}
+
+std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view& text) const
+{
+    std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(text, words);
+    return words;
+}
+
+void SearchServer::SplitIntoWordsNoStop(const std::string_view& text, std::vector<std::string_view>& words) const
+{
+    if (!SplitIntoWords(text, words))
+    {
+        const auto invalid_word = std::find_if_not(words.begin(), words.end(), [this](const std::string_view word)
+        {
+            return IsValidWord(word);
+        });
+        throw std::invalid_argument("Word "s + std::string(*invalid_word) + " is invalid"s);
+    }
+
+    FilterStopWords(words);
+}
+
+bool SearchServer::Query::HasRequiredTerms() const
+{
+    return !required_terms.empty() || !phrases.empty() || has_unknown_required_word;
+}
+
+int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
+{
+    if (ratings.empty())
+    {
+        return 0;
+    }
+
+    int rating_sum = std::accumulate(ratings.begin(), ratings.end(), 0);
+
+    return rating_sum / static_cast<int>(ratings.size());
+}
+
+SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const
+{
+    if (text.empty())
+    {
+        throw std::invalid_argument("Query word is empty"s);
+    }
+
+    std::string_view word = text;
+    bool is_minus = false;
+
+    if (word[0] == '-')
+    {
+        is_minus = true;
+        word = word.substr(1);
+    }
+
+    // управляющие символы проверяются при разбиении запроса на слова
+    if (word.empty() || word[0] == '-')
+    {
+        throw std::invalid_argument("Query word "s + std::string(text) + " is invalid"s);
+    }
+    return { word, is_minus, IsStopWord(word) };
+}
+
+SearchServer::Query SearchServer::ParseQuery(const std::string_view& text) const
+{
+    return ParseQuery(std::execution::seq, text, false);
+}
+
+void SearchServer::ParseQuery(const std::string_view& text, Query& result, std::vector<std::string_view>& words) const
+{
+    auto& min_terms = result.minus_terms;
+    auto& pls_terms = result.plus_terms;
+    min_terms.clear();
+    pls_terms.clear();
+
+    if (!SplitIntoWords(text, words))
+    {
+        const auto invalid_word = std::find_if_not(words.begin(), words.end(), [this](const std::string_view word)
+        {
+            return IsValidWord(word);
+        });
+        throw std::invalid_argument("Query word "s + std::string(*invalid_word) + " is invalid"s);
+    }
+
+    result.required_terms.clear();
+    result.phrases.clear();
+    result.has_unknown_required_word = false;
+    if (text.find('"') != std::string_view::npos)
+    {
+        ParsePhrases(words, result);
+    }
+    if (text.find('+') != std::string_view::npos)
+    {
+        ParseRequiredWords(words, result);
+    }
+
+    SortAndRemoveDublicates(words);
+
+    for (const std::string_view word : words)
+    {
+        const auto& query_word = ParseQueryWord(word);
+        if (query_word.is_stop)
+        {
+            continue;
+        }
+
+        const auto term_id = terms_.Find(query_word.data);
+        if (!term_id)
+        {
+            if (!query_word.is_minus && query_operator_ == QueryOperator::AND)
+            {
+                result.has_unknown_required_word = true;
+            }
+            continue;
+        }
+
+        if (query_word.is_minus)
+        {
+            min_terms.push_back(*term_id);
+        }
+        else
+        {
+            pls_terms.push_back(*term_id);
+        }
+    }
+
+    if (query_operator_ == QueryOperator::AND)
+    {
+        result.required_terms = pls_terms;
+    }
+    std::sort(result.required_terms.begin(), result.required_terms.end());
+    result.required_terms.erase(std::unique(result.required_terms.begin(), result.required_terms.end()), result.required_terms.end());
+}
+
+void SearchServer::ParsePhrases(std::vector<std::string_view>& words, Query& result) const
+{
+    bool is_in_phrase = false;
+    for (std::string_view& word : words)
+    {
+        if (!is_in_phrase && word[0] == '"')
+        {
+            word.remove_prefix(1);
+            is_in_phrase = true;
+            result.phrases.emplace_back();
+        }
+        const bool is_phrase_end = is_in_phrase && !word.empty() && word.back() == '"';
+        if (is_phrase_end)
+        {
+            word.remove_suffix(1);
+        }
+
+        if (is_in_phrase && !word.empty())
+        {
+            if (word[0] == '-' || word[0] == '+' || word.find('"') != std::string_view::npos)
+            {
+                throw std::invalid_argument("Query phrase word "s + std::string(word) + " is invalid"s);
+            }
+            if (!IsStopWord(word))
+            {
+                const auto term_id = terms_.Find(word);
+                if (term_id)
+                {
+                    result.phrases.back().push_back(*term_id);
+                }
+                else
+                {
+                    result.has_unknown_required_word = true;
+                }
+            }
+        }
+
+        if (is_phrase_end)
+        {
+            is_in_phrase = false;
+            // фраза из одних стоп-слов ничего не требует
+            if (result.phrases.back().empty())
+            {
+                result.phrases.pop_back();
+            }
+        }
+    }
+    if (is_in_phrase)
+    {
+        throw std::invalid_argument("Query phrase is not closed"s);
+    }
+
+    // от отдельно стоящих кавычек остались пустые слова
+    words.erase(std::remove_if(words.begin(), words.end(), [](std::string_view word) { return word.empty(); }), words.end());
+}
+
+void SearchServer::ParseRequiredWords(std::vector<std::string_view>& words, Query& result) const
+{
+    for (std::string_view& word : words)
+    {
+        if (word[0] != '+')
+        {
+            continue;
+        }
+        word.remove_prefix(1);
+        if (word.empty() || word[0] == '-' || word[0] == '+')
+        {
+            throw std::invalid_argument("Query word +"s + std::string(word) + " is invalid"s);
+        }
+        if (IsStopWord(word))
+        {
+            continue;
+        }
+
+        const auto term_id = terms_.Find(word);
+        if (term_id)
+        {
+            result.required_terms.push_back(*term_id);
+        }
+        else
+        {
+            result.has_unknown_required_word = true;
+        }
+    }
+}
+
+ScoringStatistics SearchServer::GetScoringStatistics() const
+{
+    return MakeScoringStatistics(GetDocumentCount(), total_word_count_);
+}
+
+SearchServer::Postings::Postings(ArrayView<DocumentOrdinal> mapped_ordinals, ArrayView<double> mapped_term_freqs)
+    : is_mapped_(true), mapped_ordinals_(mapped_ordinals), mapped_term_freqs_(mapped_term_freqs)
+{
+    UpdateLogDocumentFreq();
+    for (size_t i = 0; i < mapped_term_freqs_.size(); ++i)
+    {
+        UpdateMaxTermFreq(i, mapped_term_freqs_[i]);
+    }
+}
+
+SearchServer::Postings::Postings(PostingsFormat format)
+    : is_compressed_(format == PostingsFormat::COMPRESSED){}
+
+bool SearchServer::Postings::IsCompressed() const
+{
+    return is_compressed_;
+}
+
+const CompressedPostings& SearchServer::Postings::GetCompressed() const
+{
+    return compressed_;
+}
+
+void SearchServer::Postings::Detach()
+{
+    if (!is_mapped_)
+    {
+        return;
+    }
+    ordinals_.assign(mapped_ordinals_.begin(), mapped_ordinals_.end());
+    term_freqs_.assign(mapped_term_freqs_.begin(), mapped_term_freqs_.end());
+    is_mapped_ = false;
+}
+
+ArrayView<DocumentOrdinal> SearchServer::Postings::GetOrdinals() const
+{
+    return is_mapped_ ? mapped_ordinals_ : ArrayView<DocumentOrdinal>(ordinals_);
+}
+
+ArrayView<double> SearchServer::Postings::GetTermFreqs() const
+{
+    return is_mapped_ ? mapped_term_freqs_ : ArrayView<double>(term_freqs_);
+}
+
+size_t SearchServer::Postings::size() const
+{
+    return is_compressed_ ? compressed_.size() : GetOrdinals().size();
+}
+
+size_t SearchServer::Postings::GetDocumentFreq() const
+{
+    return size() - removed_count_;
+}
+
+double SearchServer::Postings::GetLogDocumentFreq() const
+{
+    return log_document_freq_;
+}
+
+double SearchServer::Postings::GetMaxTermFreq() const
+{
+    return max_term_freq_;
+}
+
+double SearchServer::Postings::GetBlockMaxTermFreq(size_t block_index) const
+{
+    return block_max_term_freqs_[block_index];
+}
+
+// position - место вхождения в списке; блоки совпадают с блоками CompressedPostings
+void SearchServer::Postings::UpdateMaxTermFreq(size_t position, double term_freq)
+{
+    if (position % POSTINGS_BLOCK_SIZE == 0)
+    {
+        block_max_term_freqs_.push_back(term_freq);
+    }
+    else
+    {
+        block_max_term_freqs_.back() = std::max(block_max_term_freqs_.back(), term_freq);
+    }
+    max_term_freq_ = std::max(max_term_freq_, term_freq);
+}
+
+// IDF слова меняется только при изменении его списка, поэтому логарифм считается здесь, а не в каждом запросе
+void SearchServer::Postings::UpdateLogDocumentFreq()
+{
+    log_document_freq_ = ComputeLogDocumentFreq(GetDocumentFreq());
+}
+
+size_t SearchServer::Postings::GetMemoryUsage() const
+{
+    if (is_compressed_)
+    {
+        return compressed_.GetMemoryUsage();
+    }
+    if (is_mapped_)
+    {
+        return mapped_ordinals_.size() * sizeof(DocumentOrdinal) + mapped_term_freqs_.size() * sizeof(double);
+    }
+    return ordinals_.capacity() * sizeof(DocumentOrdinal) + term_freqs_.capacity() * sizeof(double);
+}
+
+bool SearchServer::Postings::Contains(DocumentOrdinal ordinal) const
+{
+    if (is_compressed_)
+    {
+        return compressed_.Contains(ordinal);
+    }
+    const auto ordinals = GetOrdinals();
+    return std::binary_search(ordinals.begin(), ordinals.end(), ordinal);
+}
+
+void SearchServer::Postings::Add(DocumentOrdinal ordinal, double term_freq, uint32_t count)
+{
+    // номера выдаются по возрастанию, поэтому список остаётся отсортированным
+    if (is_compressed_)
+    {
+        compressed_.Add(ordinal, count);
+    }
+    else
+    {
+        Detach();
+        ordinals_.push_back(ordinal);
+        term_freqs_.push_back(term_freq);
+    }
+    UpdateMaxTermFreq(size() - 1, term_freq);
+    UpdateLogDocumentFreq();
+}
+
+void SearchServer::Postings::MarkRemoved()
+{
+    ++removed_count_;
+    UpdateLogDocumentFreq();
+}
+
+void SearchServer::Postings::RemoveOrdinals(const std::vector<bool>& is_removed)
+{
+    Detach();
+    size_t kept = 0;
+    max_term_freq_ = 0.0;
+    block_max_term_freqs_.clear();
+    for (size_t i = 0; i < ordinals_.size(); ++i)
+    {
+        const DocumentOrdinal ordinal = ordinals_[i];
+        if (ordinal < is_removed.size() && is_removed[ordinal])
+        {
+            continue;
+        }
+        ordinals_[kept] = ordinal;
+        term_freqs_[kept] = term_freqs_[i];
+        UpdateMaxTermFreq(kept, term_freqs_[kept]);
+        ++kept;
+    }
+    ordinals_.resize(kept);
+    term_freqs_.resize(kept);
+    removed_count_ = 0;
+    UpdateLogDocumentFreq();
+}
+
+SearchServer::PostingCursor::PostingCursor(const SearchServer& search_server, TermId term_id)
+    : search_server_(&search_server)
+    , postings_(&search_server.postings_[term_id])
+    , has_removed_(postings_->size() != postings_->GetDocumentFreq())
+{
+    if (postings_->IsCompressed())
+    {
+        LoadBlock(0);
+    }
+    else
+    {
+        ordinals_ = postings_->GetOrdinals();
+        term_freqs_ = postings_->GetTermFreqs();
+    }
+    SettleOnLiveOrdinal();
+}
+
+void SearchServer::PostingCursor::LoadBlock(size_t block_index)
+{
+    const CompressedPostings& compressed = postings_->GetCompressed();
+    block_index_ = block_index;
+    block_size_ = block_index < compressed.GetBlockCount() ? compressed.DecodeBlock(block_index, block_ordinals_, block_counts_) : 0;
+    position_ = 0;
+}
+
+// Ставит ordinal_ на вхождение под position_ или дальше, пропуская удалённые документы
+void SearchServer::PostingCursor::SettleOnLiveOrdinal()
+{
+    while (true)
+    {
+        if (postings_->IsCompressed())
+        {
+            if (position_ == block_size_)
+            {
+                if (block_index_ + 1 >= postings_->GetCompressed().GetBlockCount())
+                {
+                    ordinal_ = END;
+                    return;
+                }
+                LoadBlock(block_index_ + 1);
+                continue;
+            }
+            ordinal_ = block_ordinals_[position_];
+        }
+        else
+        {
+            if (position_ == ordinals_.size())
+            {
+                ordinal_ = END;
+                return;
+            }
+            ordinal_ = ordinals_[position_];
+        }
+
+        const std::vector<bool>& is_removed = search_server_->is_removed_;
+        if (!has_removed_ || ordinal_ >= is_removed.size() || !is_removed[ordinal_])
+        {
+            return;
+        }
+        ++position_;
+    }
+}
+
+DocumentOrdinal SearchServer::PostingCursor::GetOrdinal() const
+{
+    return ordinal_;
+}
+
+double SearchServer::PostingCursor::GetTermFreq() const
+{
+    if (postings_->IsCompressed())
+    {
+        return block_counts_[position_] * search_server_->length_norms_[ordinal_];
+    }
+    return term_freqs_[position_];
+}
+
+void SearchServer::PostingCursor::Next()
+{
+    ++position_;
+    SettleOnLiveOrdinal();
+}
+
+double SearchServer::PostingCursor::GetBlockMaxTermFreq(DocumentOrdinal target, DocumentOrdinal& last_ordinal) const
+{
+    // обычно target лежит в текущем блоке курсора, иначе блок ищется дальше
+    size_t block_index = 0;
+    if (postings_->IsCompressed())
+    {
+        const CompressedPostings& compressed = postings_->GetCompressed();
+        block_index = block_index_ < compressed.GetBlockCount() && compressed.GetBlock(block_index_).last_ordinal >= target ? block_index_ : compressed.FindBlock(target);
+        if (block_index == compressed.GetBlockCount())
+        {
+            last_ordinal = END;
+            return 0.0;
+        }
+        last_ordinal = compressed.GetBlock(block_index).last_ordinal;
+    }
+    else
+    {
+        const auto get_block_last = [this](size_t block_index)
+        {
+            return ordinals_[std::min((block_index + 1) * POSTINGS_BLOCK_SIZE, ordinals_.size()) - 1];
+        };
+        block_index = position_ / POSTINGS_BLOCK_SIZE;
+        if (position_ == ordinals_.size() || get_block_last(block_index) < target)
+        {
+            const size_t position = std::lower_bound(ordinals_.begin() + position_, ordinals_.end(), target) - ordinals_.begin();
+            if (position == ordinals_.size())
+            {
+                last_ordinal = END;
+                return 0.0;
+            }
+            block_index = position / POSTINGS_BLOCK_SIZE;
+        }
+        last_ordinal = get_block_last(block_index);
+    }
+    return postings_->GetBlockMaxTermFreq(block_index);
+}
+
+void SearchServer::PostingCursor::Seek(DocumentOrdinal target)
+{
+    if (ordinal_ >= target)
+    {
+        return;
+    }
+
+    if (postings_->IsCompressed())
+    {
+        const CompressedPostings& compressed = postings_->GetCompressed();
+        if (compressed.GetBlock(block_index_).last_ordinal < target)
+        {
+            LoadBlock(GallopSearch(block_index_, compressed.GetBlockCount(), [&compressed, target](size_t block_index)
+            {
+                return compressed.GetBlock(block_index).last_ordinal < target;
+            }));
+        }
+        position_ = std::lower_bound(block_ordinals_ + position_, block_ordinals_ + block_size_, target) - block_ordinals_;
+    }
+    else
+    {
+        position_ = GallopSearch(position_, ordinals_.size(), [this, target](size_t position)
+        {
+            return ordinals_[position] < target;
+        });
+    }
+    SettleOnLiveOrdinal();
+}
+
+std::vector<DocumentOrdinal> SearchServer::IntersectPostings(std::vector<TermId> term_ids) const
+{
+    std::vector<DocumentOrdinal> ordinals;
+    if (term_ids.empty())
+    {
+        return ordinals;
+    }
+
+    // кандидатов даёт самое редкое слово, остальные курсоры только догоняют его
+    std::sort(term_ids.begin(), term_ids.end(), [this](TermId lhs, TermId rhs)
+    {
+        return postings_[lhs].GetDocumentFreq() < postings_[rhs].GetDocumentFreq();
+    });
+    std::vector<PostingCursor> cursors;
+    cursors.reserve(term_ids.size());
+    for (const TermId term_id : term_ids)
+    {
+        cursors.emplace_back(*this, term_id);
+    }
+
+    DocumentOrdinal candidate = cursors.front().GetOrdinal();
+    while (candidate != PostingCursor::END)
+    {
+        size_t matched_count = 1;
+        for (; matched_count < cursors.size(); ++matched_count)
+        {
+            cursors[matched_count].Seek(candidate);
+            if (cursors[matched_count].GetOrdinal() != candidate)
+            {
+                break;
+            }
+        }
+
+        if (matched_count == cursors.size())
+        {
+            ordinals.push_back(candidate);
+            cursors.front().Next();
+        }
+        else if (cursors[matched_count].GetOrdinal() != PostingCursor::END)
+        {
+            cursors.front().Seek(cursors[matched_count].GetOrdinal());
+        }
+        else
+        {
+            break;
+        }
+        candidate = cursors.front().GetOrdinal();
+    }
+    return ordinals;
+}
+
+void SearchServer::DecodeQueryPositions(DocumentOrdinal ordinal, const Query& query, std::vector<std::vector<uint32_t>>& positions) const
+{
+    const auto& term_ids = documents_[ordinal].term_ids;
+    for (size_t i = 0; i < query.plus_terms.size(); ++i)
+    {
+        const auto it = std::lower_bound(term_ids.begin(), term_ids.end(), query.plus_terms[i]);
+        if (it != term_ids.end() && *it == query.plus_terms[i])
+        {
+            positions_[ordinal].Decode(it - term_ids.begin(), positions[i]);
+        }
+        else
+        {
+            positions[i].clear();
+        }
+    }
+}
+
+bool SearchServer::ArePhrasesMatched(const Query& query, const std::vector<std::vector<uint32_t>>& positions)
+{
+    // слова фраз есть среди плюс-слов, позиции лежат под тем же номером
+    const auto get_positions = [&query, &positions](TermId term_id) -> const std::vector<uint32_t>&
+    {
+        return positions[std::find(query.plus_terms.begin(), query.plus_terms.end(), term_id) - query.plus_terms.begin()];
+    };
+
+    return std::all_of(query.phrases.begin(), query.phrases.end(), [&get_positions](const std::vector<TermId>& phrase)
+    {
+        const std::vector<uint32_t>& starts = get_positions(phrase[0]);
+        return std::any_of(starts.begin(), starts.end(), [&get_positions, &phrase](uint32_t start)
+        {
+            for (size_t i = 1; i < phrase.size(); ++i)
+            {
+                const std::vector<uint32_t>& word_positions = get_positions(phrase[i]);
+                if (!std::binary_search(word_positions.begin(), word_positions.end(), start + static_cast<uint32_t>(i)))
+                {
+                    return false;
+                }
+            }
+            return true;
+        });
+    });
+}
+
+double SearchServer::ComputeProximityBoost(const std::vector<std::vector<uint32_t>>& positions)
+{
+    // все вхождения по порядку; окно сдвигается вправо и сжимается слева, пока в нём есть каждое слово
+    std::vector<std::pair<uint32_t, uint32_t>> occurrences; // позиция и номер слова запроса
+    size_t term_count = 0;
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+        term_count += positions[i].empty() ? 0 : 1;
+        for (const uint32_t position : positions[i])
+        {
+            occurrences.emplace_back(position, static_cast<uint32_t>(i));
+        }
+    }
+    if (term_count < 2)
+    {
+        return 1.0;
+    }
+    std::sort(occurrences.begin(), occurrences.end());
+
+    std::vector<uint32_t> window_counts(positions.size());
+    size_t window_term_count = 0;
+    uint32_t min_span = std::numeric_limits<uint32_t>::max();
+    for (size_t left = 0, right = 0; right < occurrences.size(); ++right)
+    {
+        if (window_counts[occurrences[right].second]++ == 0)
+        {
+            ++window_term_count;
+        }
+        for (; window_term_count == term_count; ++left)
+        {
+            min_span = std::min(min_span, occurrences[right].first - occurrences[left].first);
+            if (--window_counts[occurrences[left].second] == 0)
+            {
+                --window_term_count;
+            }
+        }
+    }
+    return 1.0 + PROXIMITY_BOOST * (term_count - 1) / min_span;
+}
+
+bool SearchServer::AreRequiredTermsMatched(DocumentOrdinal ordinal, const Query& query) const
+{
+    if (!query.phrases.empty() && !has_positions_)
+    {
+        throw std::invalid_argument("Phrase queries need the positional index"s);
+    }
+    if (query.has_unknown_required_word)
+    {
+        return false;
+    }
+    const auto& term_ids = documents_[ordinal].term_ids;
+    if (!std::all_of(query.required_terms.begin(), query.required_terms.end(), [&term_ids](TermId term_id)
+        {
+            return std::binary_search(term_ids.begin(), term_ids.end(), term_id);
+        }))
+    {
+        return false;
+    }
+    if (query.phrases.empty())
+    {
+        return true;
+    }
+    std::vector<std::vector<uint32_t>> positions(query.plus_terms.size());
+    DecodeQueryPositions(ordinal, query, positions);
+    return ArePhrasesMatched(query, positions);
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs)
+{
+    if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+    {
+        // при полном равенстве - меньший id, чтобы ответ не зависел от того, какие документы перебирались
+        return lhs.rating != rhs.rating ? lhs.rating > rhs.rating : lhs.id < rhs.id;
+    }
+    else
+    {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+std::optional<DocumentOrdinal> SearchServer::FindOrdinal(int document_id) const
+{
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+double SearchServer::ComputeTermFreq(uint32_t count, uint32_t word_count)
+{
+    return count * (1.0 / word_count);
+}
+
+void SearchServer::SortAndRemoveDublicates(std::vector<std::string_view>& dummy) const
+{
+    if (dummy.size() > 1)
+    {
+        const auto& begin_it = dummy.begin();
+        const auto& end_it = dummy.end();
+        std::sort(begin_it, end_it);
+        auto it = std::unique(begin_it, end_it);
+        dummy.resize(it - begin_it);
+    }
+}
+
+void SearchServer::MergeDocumentsFrom(const SearchServer& source, const std::set<int>& excluded_ids)
+{
+    if (has_positions_ && !source.has_positions_)
+    {
+        throw std::invalid_argument("Source index has no positions"s);
+    }
+    generation_ = NextGeneration();
+
+    // прямой индекс источника: для каждого документа его слова и число вхождений
+    std::vector<std::vector<std::pair<TermId, uint32_t>>> source_terms(source.documents_.size());
+    for (TermId term_id = 0; term_id < source.postings_.size(); ++term_id)
+    {
+        source.ForEachPosting(term_id, [&source, &source_terms, term_id](DocumentOrdinal ordinal, double term_freq)
+        {
+            const uint32_t count = static_cast<uint32_t>(std::lround(term_freq * source.documents_[ordinal].word_count));
+            source_terms[ordinal].emplace_back(term_id, count);
+        });
+    }
+
+    // слова без живых документов в словарь не попадают
+    constexpr TermId NEW_TERM = std::numeric_limits<TermId>::max();
+    std::vector<TermId> term_map(source.terms_.size(), NEW_TERM);
+
+    for (DocumentOrdinal source_ordinal = 0; source_ordinal < source.documents_.size(); ++source_ordinal)
+    {
+        const DocumentData& source_data = source.documents_[source_ordinal];
+        if (source.FindOrdinal(source_data.id) != source_ordinal || excluded_ids.count(source_data.id) > 0)
+        {
+            continue;
+        }
+
+        auto& terms = source_terms[source_ordinal];
+        for (auto& [term_id, count] : terms)
+        {
+            if (term_map[term_id] == NEW_TERM)
+            {
+                term_map[term_id] = terms_.Add(source.terms_.GetTerm(term_id));
+            }
+            term_id = term_map[term_id];
+        }
+        postings_.resize(terms_.size(), Postings(postings_format_));
+        std::sort(terms.begin(), terms.end());
+
+        const DocumentOrdinal ordinal = static_cast<DocumentOrdinal>(documents_.size());
+        std::vector<TermId> term_ids;
+        term_ids.reserve(terms.size());
+        for (const auto& [term_id, count] : terms)
+        {
+            postings_[term_id].Add(ordinal, ComputeTermFreq(count, source_data.word_count), count);
+            term_ids.push_back(term_id);
+        }
+        source_terms[source_ordinal] = {};
+
+        documents_.push_back(DocumentData{ source_data.id, source_data.rating, source_data.status, source_data.word_count, std::move(term_ids) });
+        length_norms_.push_back(source.length_norms_[source_ordinal]);
+        total_word_count_ += source_data.word_count;
+        if (has_positions_)
+        {
+            // позиции источника разложены по его id слов, поэтому документ собирается заново по новым id
+            std::vector<TermId> words(source_data.word_count);
+            std::vector<uint32_t> positions;
+            for (size_t i = 0; i < source_data.term_ids.size(); ++i)
+            {
+                source.positions_[source_ordinal].Decode(i, positions);
+                for (const uint32_t position : positions)
+                {
+                    words[position] = term_map[source_data.term_ids[i]];
+                }
+            }
+            positions_.emplace_back(words);
+        }
+        document_ordinals_.emplace(source_data.id, ordinal);
+        document_ids_.insert(source_data.id);
+    }
+}
+
+// Удаление не трогает списки вхождений: только бит в карте и счётчики документных частот слов
+bool SearchServer::MarkDocumentRemoved(int document_id)
 {
-    SetStopWords(SplitIntoWords(stop_words));
+    const auto ordinal_it = document_ordinals_.find(document_id);
+    if (ordinal_it == document_ordinals_.end())
+    {
+        return false;
+    }
+    generation_ = NextGeneration();
+
+    const DocumentOrdinal ordinal = ordinal_it->second;
+    for (const TermId term_id : documents_[ordinal].term_ids)
+    {
+        postings_[term_id].MarkRemoved();
+    }
+    if (is_removed_.size() < documents_.size())
+    {
+        is_removed_.resize(documents_.size());
+    }
+    is_removed_[ordinal] = true;
+    pending_removals_.push_back(ordinal);
+    total_word_count_ -= documents_[ordinal].word_count;
+
+    document_ids_.erase(document_id);
+    document_ordinals_.erase(ordinal_it);
+
+    return 4 * pending_removals_.size() > document_ids_.size();
 }
 
-SearchServer::SearchServer(std::string_view stop_words)
+namespace
 {
-    SetStopWords(SplitIntoWords(stop_words));
+    // финальное перемешивание splitmix64
+    uint64_t MixHash(uint64_t x)
+    {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
 }
 
-//--------------------private methods------------------//
-
-bool SearchServer::IsStopWord(const std::string_view& word) const
+uint64_t SearchServer::NextGeneration()
 {
-    return stop_words_.count(static_cast<std::string>(word)) > 0;
+    static std::atomic<uint64_t> last_generation = 0;
+    return ++last_generation;
 }
 
-bool SearchServer::IsValidWord(const std::string_view& word) const
+uint64_t SearchServer::ComputeTermSetSignature(const std::vector<TermId>& term_ids)
 {
-    return std::none_of(word.begin(), word.end(), [](char c)
+    // каждый id перемешивается вместе с предыдущим значением, так что порядок и состав важны
+    uint64_t signature = term_ids.size();
+    for (const TermId term_id : term_ids)
     {
-        return c >= '\0' && c < ' ';
-    });
+        signature = MixHash(signature + term_id + 0x9E3779B97F4A7C15ull);
+    }
+    return signature;
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(const std::string_view& text) const
+std::vector<DocumentOrdinal> SearchServer::GetLiveOrdinals() const
 {
-    std::vector<std::string_view> words;
-    for (const std::string_view& word : SplitIntoWords(text))
+    std::vector<DocumentOrdinal> ordinals;
+    ordinals.reserve(document_ordinals_.size());
+    for (const auto& [document_id, ordinal] : document_ordinals_)
     {
-        if (!IsValidWord(word))
-        {
-            throw std::invalid_argument("Word "s + std::string(word) + " is invalid"s);
-        }
+        ordinals.push_back(ordinal);
+    }
+    return ordinals;
+}
 
-        if (!IsStopWord(word))
+void SearchServer::ComputeBandHashes(const std::vector<TermId>& term_ids, const NearDuplicateOptions& options, uint64_t* band_hashes, size_t stride)
+{
+    // i-я хеш-функция подписи - MixHash(id слова + i-я соль), значение подписи - минимум по словам
+    for (size_t band = 0; band < options.band_count; ++band)
+    {
+        uint64_t band_hash = band;
+        for (size_t row = 0; row < options.rows_per_band; ++row)
         {
-            words.push_back(word);
+            const uint64_t salt = MixHash(band * options.rows_per_band + row + 1);
+            uint64_t min_hash = std::numeric_limits<uint64_t>::max();
+            for (const TermId term_id : term_ids)
+            {
+                min_hash = std::min(min_hash, MixHash(term_id ^ salt));
+            }
+            band_hash = MixHash(band_hash ^ min_hash);
         }
+        band_hashes[band * stride] = band_hash;
     }
-    return words;
 }
 
-int SearchServer::ComputeAverageRating(const std::vector<int>& ratings)
+bool SearchServer::IsNearDuplicate(const std::vector<TermId>& lhs, const std::vector<TermId>& rhs, double jaccard_threshold)
 {
-    if (ratings.empty())
+    // оба набора отсортированы: пересечение считается слиянием
+    size_t intersection = 0;
+    for (auto lhs_it = lhs.begin(), rhs_it = rhs.begin(); lhs_it != lhs.end() && rhs_it != rhs.end();)
     {
-        return 0;
+        if (*lhs_it < *rhs_it)
+        {
+            ++lhs_it;
+        }
+        else if (*rhs_it < *lhs_it)
+        {
+            ++rhs_it;
+        }
+        else
+        {
+            ++intersection;
+            ++lhs_it;
+            ++rhs_it;
+        }
     }
-
-    int rating_sum = std::accumulate(ratings.begin(), ratings.end(), 0);
-
-    return rating_sum / static_cast<int>(ratings.size());
+    const size_t union_size = lhs.size() + rhs.size() - intersection;
+    // два пустых набора совпадают, как и в точном поиске дубликатов
+    return union_size == 0 || intersection >= jaccard_threshold * union_size - EPSILON;
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const
+uint32_t SearchServer::FindClusterRoot(std::vector<uint32_t>& parents, uint32_t index)
 {
-    if (text.empty())
+    while (parents[index] != index)
     {
-        throw std::invalid_argument("Query word is empty"s);
+        parents[index] = parents[parents[index]];
+        index = parents[index];
     }
+    return index;
+}
 
-    std::string_view word = text;
-    bool is_minus = false;
-
-    if (word[0] == '-')
+std::vector<std::vector<int>> SearchServer::CollectClusters(const std::vector<DocumentOrdinal>& ordinals, std::vector<uint32_t>& parents) const
+{
+    // корень кластера - его документ с наименьшим id, он идёт в кластере первым
+    std::vector<std::vector<int>> clusters;
+    std::vector<uint32_t> cluster_by_root(ordinals.size(), std::numeric_limits<uint32_t>::max());
+    for (uint32_t i = 0; i < ordinals.size(); ++i)
     {
-        is_minus = true;
-        word = word.substr(1);
+        const uint32_t root = FindClusterRoot(parents, i);
+        if (root == i)
+        {
+            continue;
+        }
+        if (cluster_by_root[root] == std::numeric_limits<uint32_t>::max())
+        {
+            cluster_by_root[root] = clusters.size();
+            clusters.push_back({ documents_[ordinals[root]].id });
+        }
+        clusters[cluster_by_root[root]].push_back(documents_[ordinals[i]].id);
     }
+    std::sort(clusters.begin(), clusters.end());
+    return clusters;
+}
 
-    if (word.empty() || word[0] == '-' || !IsValidWord(word))
+std::vector<TermId> SearchServer::CollectPendingRemovalTerms() const
+{
+    std::vector<TermId> term_ids;
+    for (const DocumentOrdinal ordinal : pending_removals_)
     {
-        throw std::invalid_argument("Query word "s + std::string(text) + " is invalid"s);
+        term_ids.insert(term_ids.end(), documents_[ordinal].term_ids.begin(), documents_[ordinal].term_ids.end());
     }
-    return { word, is_minus, IsStopWord(word) };
+    std::sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    return term_ids;
 }
 
-SearchServer::Query SearchServer::ParseQuery(const std::string_view& text) const
+void SearchServer::RebuildPostings(TermId term_id)
 {
-    return ParseQuery(std::execution::seq, text, false);
-}
+    Postings& postings = postings_[term_id];
+    if (!postings.IsCompressed())
+    {
+        postings.RemoveOrdinals(is_removed_);
+        return;
+    }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view& word) const
-{
-    return std::log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+    // ForEachPosting уже пропускает удалённые документы
+    Postings compacted(postings_[term_id].IsCompressed() ? PostingsFormat::COMPRESSED : PostingsFormat::PLAIN);
+    ForEachPosting(term_id, [this, &compacted](DocumentOrdinal ordinal, double term_freq)
+    {
+        const uint32_t count = static_cast<uint32_t>(std::lround(term_freq * documents_[ordinal].word_count));
+        compacted.Add(ordinal, term_freq, count);
+    });
+    postings_[term_id] = std::move(compacted);
 }
 
-void SearchServer::SortAndRemoveDublicates(std::vector<std::string_view>& dummy) const
+void SearchServer::FinishCompaction()
 {
-    if (dummy.size() > 1)
+    for (const DocumentOrdinal ordinal : pending_removals_)
     {
-        const auto& begin_it = dummy.begin();
-        const auto& end_it = dummy.end();
-        std::sort(begin_it, end_it);
-        auto it = std::unique(begin_it, end_it);
-        dummy.resize(it - begin_it);
+        documents_[ordinal].term_ids.clear();
+        documents_[ordinal].term_ids.shrink_to_fit();
+        if (has_positions_)
+        {
+            positions_[ordinal].Clear();
+        }
     }
+    pending_removals_.clear();
 }
 
 //--------------------public methods------------------//
@@ -113,36 +1075,61 @@ void SearchServer::AddDocument(int document_id, const std::string_view& document
     {
         throw std::invalid_argument( "Document id "s + std::to_string(document_id) + " is invalid (is negative)" );
     }
-    if (documents_.count(document_id) > 0)
+    if (document_ordinals_.count(document_id) > 0)
     {
        throw std::invalid_argument( "Document with such ID"s + std::to_string(document_id)  + "already exists" );
     }
+    generation_ = NextGeneration();
 
-    const auto words = SplitIntoWordsNoStop(document);
-    std::vector<std::string> words_(words.begin(), words.end());
-    const double inv_word_count = 1.0 / words.size();
+    // буфер слов у каждого потока свой и переживает вызовы: разбор документа не обращается к куче
+    thread_local std::vector<std::string_view> words;
+    SplitIntoWordsNoStop(document, words);
+    const DocumentOrdinal ordinal = static_cast<DocumentOrdinal>(documents_.size());
 
-    documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, words_ });
+    std::vector<TermId> term_ids;
+    term_ids.reserve(words.size());
+    for (const std::string_view word : words)
+    {
+        term_ids.push_back(terms_.Add(word));
+    }
+    postings_.resize(terms_.size(), Postings(postings_format_));
+    if (has_positions_)
+    {
+        positions_.emplace_back(term_ids);
+    }
 
-    for (const std::string& word : documents_.at(document_id).words_list)
+    // одинаковые id оказываются рядом, TF слова - доля его вхождений
+    const uint32_t word_count = static_cast<uint32_t>(words.size());
+    std::sort(term_ids.begin(), term_ids.end());
+    for (auto it = term_ids.begin(); it != term_ids.end();)
     {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        freqs_by_id_[document_id][word] += inv_word_count;
+        const auto run_end = std::find_if(it, term_ids.end(), [it](TermId term_id) { return term_id != *it; });
+        const uint32_t count = static_cast<uint32_t>(run_end - it);
+        postings_[*it].Add(ordinal, ComputeTermFreq(count, word_count), count);
+        it = run_end;
     }
+    term_ids.erase(std::unique(term_ids.begin(), term_ids.end()), term_ids.end());
+
+    documents_.push_back(DocumentData{ document_id, ComputeAverageRating(ratings), status, word_count, std::move(term_ids) });
+    length_norms_.push_back(1.0 / word_count);
+    total_word_count_ += word_count;
+    document_ordinals_.emplace(document_id, ordinal);
     document_ids_.insert(document_id);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
 {
-    return FindTopDocuments(raw_query, [&status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
-    {
-        return document_status == status;
-    });
+    return FindTopDocuments<TfIdfScoring>(raw_query, status, max_count);
 }
 
 std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query) const
 {
-    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+    return FindTopDocuments<TfIdfScoring>(raw_query);
+}
+
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryScratch& scratch, const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return FindTopDocuments<TfIdfScoring>(scratch, raw_query, status, max_count);
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::string_view raw_query, int document_id) const
@@ -150,31 +1137,34 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
     const auto query = ParseQuery(raw_query);
     std::vector<std::string_view> matched_words;
 
-    if (documents_.count(document_id) == 0)
+    const auto ordinal = FindOrdinal(document_id);
+    if (!ordinal)
     {
         throw std::out_of_range("Document out of range");
     }
+    const DocumentStatus status = documents_[*ordinal].status;
 
+    // результат зависит только от слов документа: слова, которого нет в словаре, нет и в документе.
+    // Поэтому ShardedSearchServer и SegmentedSearchServer совпадают с одним сервером, хотя словари у шардов свои
+    const auto contains = [this, ordinal = *ordinal](TermId term_id)
+    {
+        return postings_[term_id].Contains(ordinal);
+    };
+    if (std::any_of(query.minus_terms.begin(), query.minus_terms.end(), contains)
+        || (query.HasRequiredTerms() && !AreRequiredTermsMatched(*ordinal, query)))
+    {
+        return { matched_words, status };
+    }
 
-    for (const std::string_view& word : query.minus_words)
+    // plus_terms идут в порядке слов запроса, отсортированных без повторов
+    for (const TermId term_id : query.plus_terms)
     {
-        if (word_to_document_freqs_.count(word) > 0 && word_to_document_freqs_.at(word).count(document_id) > 0)
-        {
-            matched_words.clear();
-            continue;
-        }
-        else
+        if (contains(term_id))
         {
-            for (const std::string_view& word : query.plus_words)
-            {
-                if (word_to_document_freqs_.count(word) > 0 && word_to_document_freqs_.at(word).count(document_id) > 0)
-                {
-                    matched_words.push_back(word);
-                }
-            }
+            matched_words.push_back(terms_.GetTerm(term_id));
         }
     }
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, status };
 }
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const
@@ -184,31 +1174,36 @@ std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDoc
 
 std::tuple<std::vector<std::string_view>, DocumentStatus> SearchServer::MatchDocument(std::execution::parallel_policy policy, std::string_view raw_query, int document_id) const
 {
-    if (documents_.count(document_id) == 0)
+    const auto ordinal = FindOrdinal(document_id);
+    if (!ordinal)
     {
         throw std::out_of_range("Wrong document id");
     }
 
     auto query = ParseQuery(policy, raw_query);
 
-    const auto l = [this, document_id](std::string_view word)
+    const auto l = [this, ordinal = *ordinal](TermId term_id)
     {
-        const auto it = word_to_document_freqs_.find(word);
-        return it != word_to_document_freqs_.end() && it->second.count(document_id);
+        return postings_[term_id].Contains(ordinal);
     };
 
-    const auto& status = documents_.at(document_id).status;
+    const auto& status = documents_[*ordinal].status;
 
-    if (std::any_of(policy, query.minus_words.begin(), query.minus_words.end(), l))
+    if (std::any_of(policy, query.minus_terms.begin(), query.minus_terms.end(), l) || (query.HasRequiredTerms() && !AreRequiredTermsMatched(*ordinal, query)))
     {
         return { std::vector<std::string_view>{}, status };
     }
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
+    std::vector<TermId> matched_terms(query.plus_terms.size());
 
-    auto it = std::copy_if(policy, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(), l);
+    auto it = std::copy_if(policy, query.plus_terms.begin(), query.plus_terms.end(), matched_terms.begin(), l);
 
-    matched_words.erase(it, matched_words.end());
+    std::vector<std::string_view> matched_words;
+    matched_words.reserve(it - matched_terms.begin());
+    std::for_each(matched_terms.begin(), it, [this, &matched_words](TermId term_id)
+    {
+        matched_words.push_back(terms_.GetTerm(term_id));
+    });
     SortAndRemoveDublicates(matched_words);
 
     return { matched_words, status };
@@ -219,51 +1214,40 @@ void SearchServer::RemoveDocument(int document_id)
     return RemoveDocument(std::execution::seq, document_id);
 }
 
-void SearchServer::RemoveDocument(const std::execution::parallel_policy&, int document_id)
+void SearchServer::RemoveDocument(const std::execution::parallel_policy& policy, int document_id)
 {
-    const auto& doc_to_freq = freqs_by_id_.find(document_id);
-
-    if (doc_to_freq == freqs_by_id_.end())
+    if (MarkDocumentRemoved(document_id))
     {
-        return;
+        CompactPostings(policy);
     }
+}
 
-    const auto& words_freq = doc_to_freq->second;
-    std::vector<const std::string*> words_to_remove(words_freq.size());
-
-    std::transform(std::execution::par, words_freq.begin(), words_freq.end(), words_to_remove.begin(),
-    [](const auto& word_to_freq)
-    {
-        return &word_to_freq.first;
-    });
-
-    std::for_each(std::execution::par, words_to_remove.begin(), words_to_remove.end(),
-    [this, document_id](const auto& word_to_remove)
+void SearchServer::RemoveDocument(const std::execution::sequenced_policy& policy, int document_id)
+{
+    if (MarkDocumentRemoved(document_id))
     {
-        this->word_to_document_freqs_.at(*word_to_remove).erase(document_id);
-    });
+        CompactPostings(policy);
+    }
+}
 
-    freqs_by_id_.erase(doc_to_freq);
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
+void SearchServer::RemoveDocuments(const std::vector<int>& document_ids)
+{
+    RemoveDocuments(std::execution::seq, document_ids);
 }
 
-void SearchServer::RemoveDocument(const std::execution::sequenced_policy &, int document_id)
+std::vector<int> SearchServer::FindDuplicates() const
 {
-    if (document_ids_.count(document_id) == 0)
-    {
-        const auto & word_freq = GetWordFrequencies(document_id);
-        for_each(std::execution::seq, word_freq.begin(), word_freq.end(), [&document_id, this](const auto& item)
-        {
-            word_to_document_freqs_.at(item.first).erase(document_id);
-        ;});
-    }
+    return FindDuplicates(std::execution::seq);
+}
 
-    document_ids_.erase(document_id);
-    documents_.erase(document_id);
-    freqs_by_id_.erase(document_id);
+std::vector<std::vector<int>> SearchServer::FindNearDuplicates(const NearDuplicateOptions& options) const
+{
+    return FindNearDuplicates(std::execution::seq, options);
+}
 
-    return;
+void SearchServer::CompactPostings()
+{
+    CompactPostings(std::execution::seq);
 }
 
 void AddDocument(SearchServer& search_server, int document_id, const std::string_view& document, DocumentStatus status,
@@ -295,20 +1279,303 @@ void FindTopDocuments(const SearchServer& search_server, const std::string_view&
     }
 }
 
+void SearchServer::FilterStopWords(std::vector<std::string_view>& words) const
+{
+    if (stop_words_.empty())
+    {
+        return;
+    }
+    words.erase(std::remove_if(words.begin(), words.end(), [this](const std::string_view word)
+    {
+        return IsStopWord(word);
+    }), words.end());
+}
+
 size_t SearchServer::GetDocumentCount() const
 {
-    return documents_.size();
+    return document_ids_.size();
+}
+
+uint64_t SearchServer::GetGeneration() const
+{
+    return generation_;
+}
+
+std::map<std::string_view, double> SearchServer::GetWordFrequencies(int document_id) const
+{
+    std::map<std::string_view, double> word_freqs;
+    const auto ordinal = FindOrdinal(document_id);
+    if (!ordinal)
+    {
+        return word_freqs;
+    }
+
+    for (const TermId term_id : documents_[*ordinal].term_ids)
+    {
+        ForEachPosting(term_id, *ordinal, *ordinal + 1, [&](DocumentOrdinal, double term_freq)
+        {
+            word_freqs.emplace(terms_.GetTerm(term_id), term_freq);
+        });
+    }
+    return word_freqs;
+}
+
+PostingsFormat SearchServer::GetPostingsFormat() const
+{
+    return postings_format_;
+}
+
+QueryEvaluation SearchServer::GetQueryEvaluation() const
+{
+    return query_evaluation_;
+}
+
+QueryOperator SearchServer::GetQueryOperator() const
+{
+    return query_operator_;
+}
+
+bool SearchServer::HasPositionalIndex() const
+{
+    return has_positions_;
+}
+
+void SearchServer::SetQueryEvaluation(QueryEvaluation query_evaluation)
+{
+    query_evaluation_ = query_evaluation;
+}
+
+// запросы с обязательными словами перебирают пересечение списков, WAND им не нужен
+bool SearchServer::IsWandQuery(const Query& query) const
+{
+    return query_evaluation_ == QueryEvaluation::WAND && !query.HasRequiredTerms() && query.plus_terms.size() <= WAND_MAX_QUERY_TERMS;
+}
+
+void SearchServer::SetQueryOperator(QueryOperator query_operator)
+{
+    query_operator_ = query_operator;
+}
+
+void SearchServer::SetPositionalIndex(bool enabled)
+{
+    if (enabled == has_positions_)
+    {
+        return;
+    }
+    if (enabled && !documents_.empty())
+    {
+        throw std::invalid_argument("Positional index can be enabled only before adding documents"s);
+    }
+    has_positions_ = enabled;
+    positions_ = {};
+}
+
+size_t SearchServer::GetPostingsMemoryUsage() const
+{
+    size_t memory_usage = 0;
+    for (const Postings& postings : postings_)
+    {
+        memory_usage += postings.GetMemoryUsage();
+    }
+    for (const DocumentPositions& positions : positions_)
+    {
+        memory_usage += positions.GetMemoryUsage();
+    }
+    return memory_usage;
+}
+
+void SearchServer::SetPostingsFormat(PostingsFormat format)
+{
+    if (format == postings_format_)
+    {
+        return;
+    }
+
+    for (TermId term_id = 0; term_id < postings_.size(); ++term_id)
+    {
+        Postings converted(format);
+        ForEachPosting(term_id, [this, &converted](DocumentOrdinal ordinal, double term_freq)
+        {
+            const uint32_t count = static_cast<uint32_t>(std::lround(term_freq * documents_[ordinal].word_count));
+            converted.Add(ordinal, term_freq, count);
+        });
+        postings_[term_id] = std::move(converted);
+    }
+    postings_format_ = format;
+}
+
+void SearchServer::SaveIndex(const std::string& path) const
+{
+    IndexWriter writer(path);
+    writer.WriteArray(ArrayView<char>(INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC)));
+    writer.Write(INDEX_FILE_VERSION);
+    writer.Write(uint32_t{0});
+
+    writer.Write(static_cast<uint64_t>(stop_words_.size()));
+    for (const std::string& word : stop_words_)
+    {
+        writer.WriteString(word);
+    }
+
+    writer.Write(static_cast<uint64_t>(terms_.size()));
+    for (TermId term_id = 0; term_id < terms_.size(); ++term_id)
+    {
+        writer.WriteString(terms_.GetTerm(term_id));
+    }
+
+    // удалённые документы не сохраняются, номера оставшихся уплотняются с сохранением порядка
+    std::vector<bool> is_alive(documents_.size());
+    for (const auto& [document_id, ordinal] : document_ordinals_)
+    {
+        is_alive[ordinal] = true;
+    }
+    std::vector<DocumentOrdinal> saved_ordinals(documents_.size());
+    uint64_t saved_document_count = 0;
+    for (DocumentOrdinal ordinal = 0; ordinal < documents_.size(); ++ordinal)
+    {
+        saved_ordinals[ordinal] = static_cast<DocumentOrdinal>(saved_document_count);
+        saved_document_count += is_alive[ordinal] ? 1 : 0;
+    }
+
+    // TF прямого индекса собираются одним проходом по спискам: term_ids документа отсортированы
+    std::vector<std::vector<double>> forward_term_freqs(documents_.size());
+    for (TermId term_id = 0; term_id < postings_.size(); ++term_id)
+    {
+        ForEachPosting(term_id, [&forward_term_freqs](DocumentOrdinal ordinal, double term_freq)
+        {
+            forward_term_freqs[ordinal].push_back(term_freq);
+        });
+    }
+
+    writer.Write(saved_document_count);
+    for (DocumentOrdinal ordinal = 0; ordinal < documents_.size(); ++ordinal)
+    {
+        if (!is_alive[ordinal])
+        {
+            continue;
+        }
+        const DocumentData& document_data = documents_[ordinal];
+
+        writer.Write(static_cast<int32_t>(document_data.id));
+        writer.Write(static_cast<int32_t>(document_data.rating));
+        writer.Write(static_cast<int32_t>(document_data.status));
+        writer.Write(document_data.word_count);
+        writer.Write(static_cast<uint32_t>(document_data.term_ids.size()));
+        writer.Align(sizeof(TermId));
+        writer.WriteArray(ArrayView<TermId>(document_data.term_ids));
+        writer.Align(sizeof(double));
+        writer.WriteArray(ArrayView<double>(forward_term_freqs[ordinal]));
+    }
+
+    for (TermId term_id = 0; term_id < postings_.size(); ++term_id)
+    {
+        std::vector<DocumentOrdinal> ordinals;
+        std::vector<double> term_freqs;
+        ordinals.reserve(postings_[term_id].size());
+        term_freqs.reserve(postings_[term_id].size());
+        ForEachPosting(term_id, [&](DocumentOrdinal ordinal, double term_freq)
+        {
+            ordinals.push_back(saved_ordinals[ordinal]);
+            term_freqs.push_back(term_freq);
+        });
+
+        writer.Align(sizeof(uint64_t));
+        writer.Write(static_cast<uint64_t>(ordinals.size()));
+        writer.WriteArray(ArrayView<DocumentOrdinal>(ordinals));
+        writer.Align(sizeof(double));
+        writer.WriteArray(ArrayView<double>(term_freqs));
+    }
+    writer.Finish();
 }
 
-const std::map<std::string, double>& SearchServer::GetWordFrequencies(int document_id) const
+void SearchServer::LoadIndex(const std::string& path)
 {
-    const auto it_to_doc = freqs_by_id_.find(document_id);
+    auto index_file = std::make_shared<const MappedFile>(path);
+    IndexReader reader(index_file->data(), index_file->size());
+
+    const auto magic = reader.ReadArray<char>(sizeof(INDEX_FILE_MAGIC));
+    if (!std::equal(magic.begin(), magic.end(), INDEX_FILE_MAGIC))
+    {
+        throw std::invalid_argument("File "s + path + " is not a search server index"s);
+    }
+    if (reader.Read<uint32_t>() != INDEX_FILE_VERSION)
+    {
+        throw std::invalid_argument("Index file "s + path + " has unsupported version"s);
+    }
+    reader.Read<uint32_t>();
+
+    SearchServer loaded;
+
+    const uint64_t stop_word_count = reader.Read<uint64_t>();
+    for (uint64_t i = 0; i < stop_word_count; ++i)
+    {
+        loaded.stop_words_.insert(std::string(reader.ReadString()));
+    }
+
+    const uint64_t term_count = reader.Read<uint64_t>();
+    for (uint64_t i = 0; i < term_count; ++i)
+    {
+        if (loaded.terms_.Add(reader.ReadString()) != i)
+        {
+            throw std::invalid_argument("Index file "s + path + " has duplicate terms"s);
+        }
+    }
+
+    const uint64_t document_count = reader.Read<uint64_t>();
+    loaded.documents_.reserve(document_count);
+    loaded.length_norms_.reserve(document_count);
+    for (uint64_t i = 0; i < document_count; ++i)
+    {
+        const int document_id = reader.Read<int32_t>();
+        const int rating = reader.Read<int32_t>();
+        const int32_t status = reader.Read<int32_t>();
+        const uint32_t word_count = reader.Read<uint32_t>();
+        const uint32_t document_term_count = reader.Read<uint32_t>();
+        reader.Align(sizeof(TermId));
+        const auto term_ids = reader.ReadArray<TermId>(document_term_count);
+        reader.Align(sizeof(double));
+        // TF документа есть и в postings, прямой индекс читается только ради формата файла
+        reader.ReadArray<double>(document_term_count);
+
+        // id слов документа различны и идут по возрастанию
+        if (status < static_cast<int32_t>(DocumentStatus::ACTUAL) || status > static_cast<int32_t>(DocumentStatus::REMOVED)
+            || (!term_ids.empty() && term_ids[term_ids.size() - 1] >= term_count)
+            || std::adjacent_find(term_ids.begin(), term_ids.end(), std::greater_equal<TermId>()) != term_ids.end())
+        {
+            throw std::invalid_argument("Index file "s + path + " is corrupted"s);
+        }
 
-    const static std::map<std::string, double> map_to_return;
+        const DocumentOrdinal ordinal = static_cast<DocumentOrdinal>(i);
+        if (!loaded.document_ordinals_.emplace(document_id, ordinal).second)
+        {
+            throw std::invalid_argument("Index file "s + path + " has duplicate document id "s + std::to_string(document_id));
+        }
+        loaded.documents_.push_back(DocumentData{ document_id, rating, static_cast<DocumentStatus>(status), word_count,
+                                                  std::vector<TermId>(term_ids.begin(), term_ids.end()) });
+        loaded.length_norms_.push_back(1.0 / word_count);
+        loaded.total_word_count_ += word_count;
+        loaded.document_ids_.insert(document_id);
+    }
 
-    if (it_to_doc == freqs_by_id_.end())
+    loaded.postings_.reserve(term_count);
+    for (uint64_t i = 0; i < term_count; ++i)
     {
-        return map_to_return;
+        reader.Align(sizeof(uint64_t));
+        const uint64_t postings_size = reader.Read<uint64_t>();
+        const auto ordinals = reader.ReadArray<DocumentOrdinal>(postings_size);
+        reader.Align(sizeof(double));
+        const auto term_freqs = reader.ReadArray<double>(postings_size);
+
+        // списки вхождений должны быть строго упорядочены: на этом держатся поиск курсорами и слияние списков
+        if ((!ordinals.empty() && ordinals[ordinals.size() - 1] >= document_count)
+            || std::adjacent_find(ordinals.begin(), ordinals.end(), std::greater_equal<DocumentOrdinal>()) != ordinals.end())
+        {
+            throw std::invalid_argument("Index file "s + path + " is corrupted"s);
+        }
+        loaded.postings_.emplace_back(ordinals, term_freqs);
     }
-    return it_to_doc->second;
+
+    // из файла списки читаются как PLAIN, сжимаются они по запросу через SetPostingsFormat
+    loaded.index_file_ = std::move(index_file);
+    *this = std::move(loaded);
 }
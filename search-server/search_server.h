@@ -4,8 +4,13 @@
 #include "paginator.h"
 #include "read_input_functions.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
 #include "log_duration.h"
+#include "term_dictionary.h"
+#include "array_view.h"
+#include "index_file.h"
+#include "compressed_postings.h"
+#include "document_positions.h"
+#include "scoring_policy.h"
 
 #include <vector>
 #include <string>
@@ -18,20 +23,93 @@
 #include <cmath>
 #include <execution>
 #include <future>
+#include <optional>
+#include <memory>
+#include <limits>
+#include <exception>
+#include <atomic>
 
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double EPSILON = 1e-6;
+// В запросах с фразами релевантность умножается на 1 + PROXIMITY_BOOST * (k - 1) / d, где d - длина
+// самого короткого отрывка документа, в котором есть все k найденных в нём плюс-слов
+const double PROXIMITY_BOOST = 0.5;
+
+// Длиннее этого запросы с QueryEvaluation::WAND считаются полным перебором: на корпусе по закону Ципфа
+// WAND в 2 раза быстрее на 5 словах и уже медленнее на 8
+const size_t WAND_MAX_QUERY_TERMS = 5;
+
+// Внутренний плотный номер документа: присваивается по порядку добавления и не переиспользуется.
+using DocumentOrdinal = uint32_t;
+
+// Формат хранения списков вхождений: PLAIN - массивы номеров и TF, COMPRESSED - разности и число
+// вхождений в varint, блоками (в 3-5 раз меньше памяти, декодируется на лету при поиске).
+enum class PostingsFormat
+{
+    PLAIN,
+    COMPRESSED,
+};
+
+// Вычисление FindTopDocuments: EXHAUSTIVE считает релевантность по всем вхождениям всех слов, слово за словом.
+// WAND идёт по документам сразу по всем спискам и пропускает документы, которые даже с наибольшим вкладом
+// каждого слова не догонят текущие max_count лучших; результат тот же, что у EXHAUSTIVE.
+// WAND выигрывает на коротких запросах по словарю с неравномерными частотами (по закону Ципфа, как в
+// живых текстах): там у каждого документа немного слов запроса и порог быстро отсекает редкие вхождения.
+// На каждый документ-кандидат он тратит O(число слов запроса), поэтому запросы длиннее WAND_MAX_QUERY_TERMS
+// считаются полным перебором. На равномерном словаре из main.cpp отсекать почти нечего, и WAND медленнее
+// при любой длине запроса, поэтому по умолчанию EXHAUSTIVE.
+enum class QueryEvaluation
+{
+    EXHAUSTIVE,
+    WAND,
+};
+
+// Какие плюс-слова запроса обязательны: при OR - только отмеченные +слово и слова фраз, документу
+// достаточно одного из остальных. При AND обязательны все плюс-слова запроса.
+enum class QueryOperator
+{
+    OR,
+    AND,
+};
+
+// Документ для пакетного добавления через AddDocuments
+struct NewDocument
+{
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// Поиск почти дубликатов: MinHash-подпись из band_count полос по rows_per_band значений. Пара становится
+// кандидатом, если у документов совпала хотя бы одна полоса, и проверяется точной мерой Жаккара.
+// Чем больше полос и меньше строк в полосе, тем меньше пропусков и больше проверок.
+struct NearDuplicateOptions
+{
+    double jaccard_threshold = 0.8;
+    size_t band_count = 16;
+    size_t rows_per_band = 4;
+};
 
 class SearchServer
 {
+    friend class ShardedSearchServer;
+    friend class SegmentedSearchServer;
+    friend class QueryResultCache;
+
+public:
+    class QueryScratch;
+
 private:
     //------------------DATA-----------------//
 
     struct DocumentData
     {
+        int id;
         int rating;
         DocumentStatus status;
-        std::vector<std::string> words_list;
+        uint32_t word_count; // без стоп-слов
+        std::vector<TermId> term_ids; // различные слова документа по возрастанию id
     };
 
     struct QueryWord
@@ -41,44 +119,238 @@ private:
         bool is_stop;
     };
 
+    // Слова запроса, которых нет в индексе, сюда не попадают: они ничего не найдут.
+    // Обязательные слова и слова фраз в кавычках есть и среди plus_terms, стоп-слова из них выбрасываются.
     struct Query
     {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+        std::vector<TermId> required_terms;
+        std::vector<std::vector<TermId>> phrases;
+        bool has_unknown_required_word = false; // такой запрос ничего не найдёт
+
+        bool HasRequiredTerms() const;
+    };
+
+    // Плоский список вхождений слова: отсортированные номера документов и параллельный массив TF.
+    // После LoadIndex массивы смотрят прямо в отображённый файл и копируются только при изменении.
+    // В формате COMPRESSED вместо массивов хранится CompressedPostings с числом вхождений,
+    // TF из него получается делением на число слов документа. Читать вхождения - через ForEachPosting.
+    class Postings
+    {
+    private:
+        std::vector<DocumentOrdinal> ordinals_;
+        std::vector<double> term_freqs_;
+        bool is_mapped_ = false;
+        ArrayView<DocumentOrdinal> mapped_ordinals_;
+        ArrayView<double> mapped_term_freqs_;
+        bool is_compressed_ = false;
+        CompressedPostings compressed_;
+        uint32_t removed_count_ = 0; // удалённые документы, которые ещё лежат в списке до уплотнения
+        double log_document_freq_ = 0.0; // log(GetDocumentFreq()), пересчитывается при каждом изменении списка
+        double max_term_freq_ = 0.0; // не меньше TF любого документа списка, верхняя граница для WAND
+        std::vector<double> block_max_term_freqs_; // то же для каждых POSTINGS_BLOCK_SIZE вхождений подряд
+
+        void Detach();
+        void UpdateLogDocumentFreq();
+        void UpdateMaxTermFreq(size_t position, double term_freq);
+
+    public:
+        Postings() = default;
+        Postings(ArrayView<DocumentOrdinal> mapped_ordinals, ArrayView<double> mapped_term_freqs);
+        explicit Postings(PostingsFormat format);
+
+        bool IsCompressed() const;
+        const CompressedPostings& GetCompressed() const;
+        ArrayView<DocumentOrdinal> GetOrdinals() const;
+        ArrayView<double> GetTermFreqs() const;
+        size_t size() const;
+        size_t GetDocumentFreq() const;
+        double GetLogDocumentFreq() const;
+        double GetMaxTermFreq() const;
+        double GetBlockMaxTermFreq(size_t block_index) const;
+        size_t GetMemoryUsage() const;
+        bool Contains(DocumentOrdinal ordinal) const;
+        void Add(DocumentOrdinal ordinal, double term_freq, uint32_t count);
+        void MarkRemoved();
+        // Вычищает помеченные документы на месте; только для несжатого формата
+        void RemoveOrdinals(const std::vector<bool>& is_removed);
+    };
+
+    // Курсор по списку вхождений для вычисления запроса по документу за раз; удалённые документы пропускает.
+    // Сжатый список декодируется по блоку, Seek пропускает блоки целиком по заголовкам.
+    class PostingCursor
+    {
+    private:
+        const SearchServer* search_server_;
+        const Postings* postings_;
+        bool has_removed_;
+        ArrayView<DocumentOrdinal> ordinals_;
+        ArrayView<double> term_freqs_;
+        size_t position_ = 0;
+        size_t block_index_ = 0;
+        size_t block_size_ = 0;
+        DocumentOrdinal block_ordinals_[POSTINGS_BLOCK_SIZE];
+        uint32_t block_counts_[POSTINGS_BLOCK_SIZE];
+        DocumentOrdinal ordinal_ = END;
+
+        void LoadBlock(size_t block_index);
+        void SettleOnLiveOrdinal();
+
+    public:
+        static const DocumentOrdinal END = std::numeric_limits<DocumentOrdinal>::max();
+
+        double inverse_document_freq = 0.0;
+        double max_score = 0.0; // наибольший вклад слова в релевантность по политике подсчёта
+
+        PostingCursor(const SearchServer& search_server, TermId term_id);
+
+        DocumentOrdinal GetOrdinal() const;
+        double GetTermFreq() const;
+        void Next();
+        // Переходит к первому документу с номером не меньше target
+        void Seek(DocumentOrdinal target);
+        // Наибольший TF слова в документах с номерами от target до last_ordinal включительно -
+        // по блоку, в котором лежит target. Блоки не декодируются, курсор не сдвигается.
+        double GetBlockMaxTermFreq(DocumentOrdinal target, DocumentOrdinal& last_ordinal) const;
     };
 
-    std::set<std::string> stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string, double>> freqs_by_id_;
-    std::map<int, DocumentData> documents_;
+    // std::less<> позволяет искать по string_view без создания временной строки
+    std::set<std::string, std::less<>> stop_words_;
+    TermDictionary terms_;
+    std::vector<Postings> postings_; // индекс - TermId
+    // Слова документа хранятся только как id в term_ids, TF - только в postings_; строка каждого слова
+    // одна на весь сервер, в terms_
+    std::vector<DocumentData> documents_; // индекс - DocumentOrdinal, удалённые остаются с пустым term_ids
+    // 1 / word_count подряд по DocumentOrdinal: поправка на длину для политики подсчёта и TF сжатых списков
+    std::vector<double> length_norms_;
+    uint64_t total_word_count_ = 0; // по живым документам, для средней длины
+    // Удалённые, но ещё не вычищенные из postings_ документы. Поиск пропускает их по битовой карте.
+    std::vector<bool> is_removed_;
+    std::vector<DocumentOrdinal> pending_removals_;
+    std::map<int, DocumentOrdinal> document_ordinals_;
     std::set<int> document_ids_;
+    std::shared_ptr<const MappedFile> index_file_; // держит отображение, на которое смотрят postings_
+    PostingsFormat postings_format_ = PostingsFormat::PLAIN;
+    // Позиционный индекс для фраз: индекс - DocumentOrdinal, пуст, если выключен
+    bool has_positions_ = false;
+    std::vector<DocumentPositions> positions_;
+    QueryEvaluation query_evaluation_ = QueryEvaluation::EXHAUSTIVE;
+    QueryOperator query_operator_ = QueryOperator::OR;
+    // Меняется при каждом добавлении и удалении документов. Значения берутся из общего счётчика,
+    // поэтому не повторяются и после присваивания серверу другого индекса.
+    uint64_t generation_ = NextGeneration();
 
     //------------------METHODS-----------------//
 
     template <typename StringCollection>
     void SetStopWords(const StringCollection& stop_words);
 
-    bool IsStopWord(const std::string_view& word) const;
     bool IsValidWord(const std::string_view& word) const;
     std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text) const;
+    void SplitIntoWordsNoStop(const std::string_view& text, std::vector<std::string_view>& words) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
     QueryWord ParseQueryWord(const std::string_view text) const;
 
     template <typename ExecutionPolicy>
     Query ParseQuery(const ExecutionPolicy& policy, const std::string_view& text, bool SwitchSortAndNoDubs = true) const; // Спасибо за отличную идею! Надеюсь, ничего не упустил.
     Query ParseQuery(const std::string_view& text) const;
-    double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
+    void ParseQuery(const std::string_view& text, Query& result, std::vector<std::string_view>& words) const;
+    // Собирает фразы в result.phrases и снимает кавычки со слов
+    void ParsePhrases(std::vector<std::string_view>& words, Query& result) const;
+    // Собирает слова с + в result.required_terms и снимает с них +
+    void ParseRequiredWords(std::vector<std::string_view>& words, Query& result) const;
+    // log N и средняя длина документа считаются один раз на запрос, log df хранится в postings
+    ScoringStatistics GetScoringStatistics() const;
+    template <typename ScoringPolicy>
+    double ComputeWordInverseDocumentFreq(const ScoringPolicy& scoring, TermId term_id) const;
+    std::optional<DocumentOrdinal> FindOrdinal(int document_id) const;
+    static double ComputeTermFreq(uint32_t count, uint32_t word_count);
+
+    // callback(ordinal, term_freq) для вхождений слова с номерами из [range_begin, range_end) в любом формате
+    template <typename Callback>
+    void ForEachPosting(TermId term_id, DocumentOrdinal range_begin, DocumentOrdinal range_end, Callback callback) const;
+    template <typename Callback>
+    void ForEachPosting(TermId term_id, Callback callback) const;
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate) const;
-    template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy, const Query &query, DocumentPredicate document_predicate) const;
-    template <typename DocumentPredicate>
+    // scoring и inverse_document_freq(term_id) позволяют считать релевантность не по статистике этого сервера,
+    // а по всей коллекции (ShardedSearchServer, SegmentedSearchServer)
+    template <typename ScoringPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+    std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy, const ScoringPolicy& scoring, const Query& query, DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const;
+    template <typename ScoringPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+    std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy& policy, const ScoringPolicy& scoring, const Query &query, DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const;
+    template <typename ScoringPolicy = TfIdfScoring, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate) const;
+    template <typename ScoringPolicy = TfIdfScoring, typename DocumentPredicate>
     std::vector<Document> FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const;
+    template <typename ScoringPolicy, typename DocumentPredicate>
+    void FindAllDocuments(QueryScratch& scratch, DocumentPredicate document_predicate) const;
+    // Запрос с обязательными словами: считаются только документы из пересечения их списков,
+    // позиции фраз проверяются только у них
+    template <typename ScoringPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+    std::vector<Document> FindConjunctiveDocuments(const ScoringPolicy& scoring, const Query& query, DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const;
+    // Живые документы, в которых есть все слова term_ids, по возрастанию номера
+    std::vector<DocumentOrdinal> IntersectPostings(std::vector<TermId> term_ids) const;
+    // positions[i] - позиции i-го плюс-слова в документе, пусто, если его там нет
+    void DecodeQueryPositions(DocumentOrdinal ordinal, const Query& query, std::vector<std::vector<uint32_t>>& positions) const;
+    static bool ArePhrasesMatched(const Query& query, const std::vector<std::vector<uint32_t>>& positions);
+    static double ComputeProximityBoost(const std::vector<std::vector<uint32_t>>& positions);
+    bool AreRequiredTermsMatched(DocumentOrdinal ordinal, const Query& query) const;
+    // Первые max_count документов вычислением по документу за раз (QueryEvaluation::WAND) в scratch.matched_documents
+    template <typename ScoringPolicy, typename DocumentPredicate>
+    void FindTopDocumentsWand(QueryScratch& scratch, const Query& query, DocumentPredicate document_predicate, size_t max_count) const;
+    bool IsWandQuery(const Query& query) const;
 
     void SortAndRemoveDublicates(std::vector<std::string_view>& dummy) const;
 
+    // Помечает документ удалённым; возвращает true, если пора уплотнять postings
+    bool MarkDocumentRemoved(int document_id);
+    static uint64_t NextGeneration();
+    // 64-битная подпись отсортированного набора id слов
+    static uint64_t ComputeTermSetSignature(const std::vector<TermId>& term_ids);
+    // Номера живых документов по возрастанию id
+    std::vector<DocumentOrdinal> GetLiveOrdinals() const;
+    // Для каждого из ordinals - позиция первого документа с тем же набором слов
+    template <typename ExecutionPolicy>
+    std::vector<uint32_t> GroupIdenticalTermSets(const ExecutionPolicy& policy, const std::vector<DocumentOrdinal>& ordinals) const;
+    // Пишет band_count хешей полос MinHash-подписи с шагом stride
+    static void ComputeBandHashes(const std::vector<TermId>& term_ids, const NearDuplicateOptions& options, uint64_t* band_hashes, size_t stride);
+    static bool IsNearDuplicate(const std::vector<TermId>& lhs, const std::vector<TermId>& rhs, double jaccard_threshold);
+    static uint32_t FindClusterRoot(std::vector<uint32_t>& parents, uint32_t index);
+    std::vector<std::vector<int>> CollectClusters(const std::vector<DocumentOrdinal>& ordinals, std::vector<uint32_t>& parents) const;
+    std::vector<TermId> CollectPendingRemovalTerms() const;
+    void RebuildPostings(TermId term_id);
+    void FinishCompaction();
+
+    // Дописывает живые документы source, кроме excluded_ids, с сохранением их порядка
+    void MergeDocumentsFrom(const SearchServer& source, const std::set<int>& excluded_ids);
+
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
+    template <typename ExecutionPolicy>
+    static void SelectTopDocuments(const ExecutionPolicy& policy, std::vector<Document>& documents, size_t max_count);
+
 public:
+    // Буферы одного потока для поиска без выделения памяти на каждый запрос. Вместо словаря
+    // релевантность копится в плотном массиве, после запроса обнуляются только затронутые ячейки.
+    // Буферы между запросами только очищаются, поэтому после первых запросов поиск с одним и тем же
+    // QueryScratch не обращается к куче. Один объект нельзя использовать из нескольких потоков одновременно.
+    class QueryScratch
+    {
+        friend class SearchServer;
+
+        Query query;
+        std::vector<std::string_view> words;
+        std::vector<double> relevances;
+        std::vector<char> marks;
+        std::vector<DocumentOrdinal> touched_ordinals;
+        std::vector<Document> matched_documents;
+        // для QueryEvaluation::WAND
+        std::vector<PostingCursor> cursors;
+        std::vector<PostingCursor> minus_cursors;
+        std::vector<PostingCursor*> order;
+        std::vector<double> top_relevances;
+    };
+
     //------------------CONSTRUCTORS-----------------//
     SearchServer(){}
 
@@ -91,18 +363,41 @@ public:
 
     void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
 
-    template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const;
-    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+    // Индекс получается таким же, как при последовательных AddDocument в порядке documents.
+    // Все id проверяются до изменения индекса: при ошибке сервер остаётся прежним.
+    template <typename ExecutionPolicy, typename DocumentRange>
+    void AddDocuments(const ExecutionPolicy& policy, const DocumentRange& documents);
+    template <typename DocumentRange>
+    void AddDocuments(const DocumentRange& documents);
+
+    // max_count - сколько лучших документов вернуть, по умолчанию MAX_RESULT_DOCUMENT_COUNT.
+    // ScoringPolicy - формула релевантности (TfIdfScoring, Bm25Scoring или своя), например FindTopDocuments<Bm25Scoring>(query).
+    // Перегрузки без неё считают TF-IDF и собраны в search_server.cpp, где методы курсоров встраиваются в цикл поиска.
+    // Перегрузки без QueryScratch заводят буферы на каждый запрос; без обращений к куче ищет только
+    // перегрузка с QueryScratch, который вызывающий держит между запросами (как BatchQueryExecutor).
+    template <typename ScoringPolicy = TfIdfScoring, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
     std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
 
-    template <typename ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const;
-    template <typename ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status) const;
-    template <typename ExecutionPolicy>
+    template <typename ScoringPolicy = TfIdfScoring, typename ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy = TfIdfScoring, typename ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy = TfIdfScoring, typename ExecutionPolicy>
     std::vector<Document> FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query) const;   
 
+    // Результат лежит в scratch и действителен до следующего запроса с ним
+    template <typename ScoringPolicy = TfIdfScoring, typename DocumentPredicate>
+    const std::vector<Document>& FindTopDocuments(QueryScratch& scratch, const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy>
+    const std::vector<Document>& FindTopDocuments(QueryScratch& scratch, const std::string_view& raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    const std::vector<Document>& FindTopDocuments(QueryScratch& scratch, const std::string_view& raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+
     using MatchDocumentResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
     MatchDocumentResult MatchDocument(std::execution::parallel_policy, std::string_view raw_query, int document_id) const;
     MatchDocumentResult MatchDocument(std::execution::sequenced_policy, std::string_view raw_query, int document_id) const;
@@ -111,11 +406,67 @@ public:
     void RemoveDocument(int document_id);
     void RemoveDocument(const std::execution::parallel_policy&, int document_id);
     void RemoveDocument(const std::execution::sequenced_policy&, int document_id);
+    // Удаляет пачку документов; postings уплотняются не более одного раза в конце
+    template <typename ExecutionPolicy>
+    void RemoveDocuments(const ExecutionPolicy& policy, const std::vector<int>& document_ids);
+    void RemoveDocuments(const std::vector<int>& document_ids);
+
+    // Id документов, набор слов которых совпадает с набором документа с меньшим id, по возрастанию.
+    // Документы группируются по подписи набора слов, точное сравнение - только внутри группы.
+    template <typename ExecutionPolicy>
+    std::vector<int> FindDuplicates(const ExecutionPolicy& policy) const;
+    std::vector<int> FindDuplicates() const;
+
+    // Кластеры почти одинаковых документов: мера Жаккара наборов слов не ниже options.jaccard_threshold
+    // хотя бы с одним другим документом кластера. Пары-кандидаты берутся из совпавших полос MinHash (LSH),
+    // поэтому работа почти линейна по числу документов, а редкие пары у порога могут быть пропущены.
+    // Кластер - id по возрастанию, кластеры упорядочены по первому id; одиночки не возвращаются.
+    template <typename ExecutionPolicy>
+    std::vector<std::vector<int>> FindNearDuplicates(const ExecutionPolicy& policy, const NearDuplicateOptions& options = {}) const;
+    std::vector<std::vector<int>> FindNearDuplicates(const NearDuplicateOptions& options = {}) const;
+
+    // Физически убирает удалённые документы из списков вхождений. RemoveDocument вызывает его сам,
+    // когда удалённых набирается четверть от живых, - до этого поиск просто пропускает их.
+    void CompactPostings();
+    template <typename ExecutionPolicy>
+    void CompactPostings(const ExecutionPolicy& policy);
+
+    bool IsStopWord(const std::string_view& word) const;
+    // Удаляет стоп-слова из пачки слов на месте, без выделения памяти; порядок остальных слов сохраняется
+    void FilterStopWords(std::vector<std::string_view>& words) const;
 
     //------------------GETS-----------------//
 
     size_t GetDocumentCount() const;
-    const std::map<std::string, double>& GetWordFrequencies(int document_id) const;
+    // Поколение индекса: если оно не изменилось, результаты запросов тоже не изменились
+    uint64_t GetGeneration() const;
+    // Частоты собираются из списков вхождений, слова ссылаются в словарь сервера и живут, пока жив сервер
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+    PostingsFormat GetPostingsFormat() const;
+    QueryEvaluation GetQueryEvaluation() const;
+    QueryOperator GetQueryOperator() const;
+    bool HasPositionalIndex() const;
+    // Вместе с позиционным индексом
+    size_t GetPostingsMemoryUsage() const;
+
+    //------------------SETS-----------------//
+
+    // Перекодирует все списки вхождений; новые документы добавляются в выбранном формате.
+    void SetPostingsFormat(PostingsFormat format);
+    // Влияет на последовательный FindTopDocuments и поиск с QueryScratch; параллельный поиск всегда полный
+    void SetQueryEvaluation(QueryEvaluation query_evaluation);
+    void SetQueryOperator(QueryOperator query_operator);
+    // Позиции слов нужны для фраз в кавычках ("белый кот"), без них такой запрос бросает исключение.
+    // Включить можно только до добавления документов: текст документов сервер не хранит.
+    // В файл индекса позиции не сохраняются.
+    void SetPositionalIndex(bool enabled);
+
+    //------------------PERSISTENCE-----------------//
+
+    // Сохраняет стоп-слова, словарь, postings, прямой индекс, рейтинги и статусы в бинарный файл.
+    void SaveIndex(const std::string& path) const;
+    // Заменяет содержимое сервера индексом из файла. Файл отображается в память, postings не копируются.
+    void LoadIndex(const std::string& path);
 
     //------------------ITERATORS-----------------//
     auto begin() const
@@ -138,7 +489,7 @@ void SearchServer::SetStopWords(const StringCollection& stop_words)
 {
     using std::string_literals::operator""s;
 
-    for (const std::string_view& word : stop_words)
+    for (const auto& word : stop_words)
     {
         if (word != ""s)
         {
@@ -155,203 +506,992 @@ void SearchServer::SetStopWords(const StringCollection& stop_words)
     }
 }
 
-template <typename StringCollection>
-SearchServer::SearchServer(const StringCollection& stop_words)
+// Разбиение на слова и TF считаются параллельно по документам. Затем пространство id слов делится
+// на диапазоны, и каждый поток дописывает новые вхождения в свои списки: документы идут по порядку,
+// поэтому списки остаются отсортированными, а один список трогает только один поток.
+template <typename ExecutionPolicy, typename DocumentRange>
+void SearchServer::AddDocuments(const ExecutionPolicy& policy, const DocumentRange& documents)
 {
-    SetStopWords(stop_words);
-}
+    using namespace std::literals::string_literals;
 
-template <typename ExecutionPolicy, typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate) const
-{
-    if constexpr (!std::is_same<typename std::decay<ExecutionPolicy>::type, std::execution::parallel_policy>::value)
+    std::vector<const NewDocument*> batch;
+    for (const NewDocument& document : documents)
     {
-        return FindTopDocuments(raw_query, document_predicate);
+        batch.push_back(&document);
     }
-    else
+
+    std::set<int> batch_ids;
+    for (const NewDocument* document : batch)
     {
-        const Query& query = ParseQuery(raw_query);
-        std::vector<Document> matched_documents = FindAllDocuments(policy, query, document_predicate);
-        sort(policy, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs)
+        if (document->id < 0)
+        {
+            throw std::invalid_argument( "Document id "s + std::to_string(document->id) + " is invalid (is negative)" );
+        }
+        if (document_ordinals_.count(document->id) > 0 || !batch_ids.insert(document->id).second)
+        {
+            throw std::invalid_argument( "Document with such ID"s + std::to_string(document->id)  + "already exists" );
+        }
+    }
+
+    struct ParsedDocument
+    {
+        std::vector<std::string_view> words;
+        std::vector<TermId> term_ids;
+        std::vector<uint32_t> counts;
+        uint32_t word_count = 0;
+        DocumentPositions positions;
+        std::exception_ptr error;
+    };
+    std::vector<ParsedDocument> parsed(batch.size());
+    std::vector<size_t> indexes(batch.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+
+    // словарь здесь только читается, новые слова помечаются и получают id ниже
+    constexpr TermId NEW_TERM = std::numeric_limits<TermId>::max();
+    std::for_each(policy, indexes.begin(), indexes.end(), [&](size_t i)
+    {
+        ParsedDocument& parsed_document = parsed[i];
+        try
+        {
+            SplitIntoWordsNoStop(batch[i]->text, parsed_document.words);
+        }
+        catch (...)
+        {
+            parsed_document.error = std::current_exception();
+            return;
+        }
+
+        parsed_document.term_ids.reserve(parsed_document.words.size());
+        for (const std::string_view word : parsed_document.words)
+        {
+            const auto term_id = terms_.Find(word);
+            parsed_document.term_ids.push_back(term_id ? *term_id : NEW_TERM);
+        }
+    });
+    for (const ParsedDocument& parsed_document : parsed)
+    {
+        if (parsed_document.error)
         {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
+            std::rethrow_exception(parsed_document.error);
+        }
+    }
+
+    // новые слова получают id в том же порядке, что и при добавлении по одному документу
+    for (ParsedDocument& parsed_document : parsed)
+    {
+        for (size_t i = 0; i < parsed_document.term_ids.size(); ++i)
+        {
+            if (parsed_document.term_ids[i] == NEW_TERM)
             {
-                return lhs.rating > rhs.rating;
+                parsed_document.term_ids[i] = terms_.Add(parsed_document.words[i]);
             }
-            else
+        }
+    }
+    postings_.resize(terms_.size(), Postings(postings_format_));
+
+    std::for_each(policy, parsed.begin(), parsed.end(), [this](ParsedDocument& parsed_document)
+    {
+        auto& term_ids = parsed_document.term_ids;
+        parsed_document.word_count = static_cast<uint32_t>(term_ids.size());
+        if (has_positions_)
+        {
+            parsed_document.positions = DocumentPositions(term_ids);
+        }
+        std::sort(term_ids.begin(), term_ids.end());
+
+        size_t unique_count = 0;
+        for (auto it = term_ids.begin(); it != term_ids.end();)
+        {
+            const TermId term_id = *it;
+            const auto run_end = std::find_if(it, term_ids.end(), [term_id](TermId other) { return other != term_id; });
+            const uint32_t count = static_cast<uint32_t>(run_end - it);
+
+            parsed_document.counts.push_back(count);
+            term_ids[unique_count++] = term_id;
+            it = run_end;
+        }
+        term_ids.resize(unique_count);
+        parsed_document.words = {};
+    });
+
+    const DocumentOrdinal first_ordinal = static_cast<DocumentOrdinal>(documents_.size());
+    size_t range_count = 1;
+    if constexpr (std::is_same<typename std::decay<ExecutionPolicy>::type, std::execution::parallel_policy>::value)
+    {
+        // диапазонов больше, чем потоков: частые слова сосредоточены в начале словаря
+        range_count = std::max(1u, std::thread::hardware_concurrency()) * 4;
+    }
+    const size_t term_count = postings_.size();
+    const size_t range_size = std::max<size_t>((term_count + range_count - 1) / range_count, 1);
+    std::vector<size_t> range_begins;
+    for (size_t begin = 0; begin < term_count; begin += range_size)
+    {
+        range_begins.push_back(begin);
+    }
+
+    std::for_each(policy, range_begins.begin(), range_begins.end(), [&](size_t range_begin)
+    {
+        const TermId begin_id = static_cast<TermId>(range_begin);
+        const TermId end_id = static_cast<TermId>(std::min(range_begin + range_size, term_count));
+        for (size_t i = 0; i < parsed.size(); ++i)
+        {
+            const ParsedDocument& parsed_document = parsed[i];
+            const auto& term_ids = parsed_document.term_ids;
+            const DocumentOrdinal ordinal = first_ordinal + static_cast<DocumentOrdinal>(i);
+
+            for (size_t j = std::lower_bound(term_ids.begin(), term_ids.end(), begin_id) - term_ids.begin(); j < term_ids.size() && term_ids[j] < end_id; ++j)
             {
-                return lhs.relevance > rhs.relevance;
+                const uint32_t count = parsed_document.counts[j];
+                postings_[term_ids[j]].Add(ordinal, ComputeTermFreq(count, parsed_document.word_count), count);
             }
-        });
+        }
+    });
+
+    generation_ = NextGeneration();
+    documents_.reserve(documents_.size() + batch.size());
+    length_norms_.reserve(length_norms_.size() + batch.size());
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        const NewDocument& document = *batch[i];
+        ParsedDocument& parsed_document = parsed[i];
 
-        if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+        documents_.push_back(DocumentData{ document.id, ComputeAverageRating(document.ratings), document.status, parsed_document.word_count, std::move(parsed_document.term_ids) });
+        length_norms_.push_back(1.0 / parsed_document.word_count);
+        total_word_count_ += parsed_document.word_count;
+        if (has_positions_)
         {
-            matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+            positions_.push_back(std::move(parsed_document.positions));
         }
+        document_ordinals_.emplace(document.id, first_ordinal + static_cast<DocumentOrdinal>(i));
+        document_ids_.insert(document.id);
+    }
+}
+
+template <typename DocumentRange>
+void SearchServer::AddDocuments(const DocumentRange& documents)
+{
+    AddDocuments(std::execution::seq, documents);
+}
+
+template <typename StringCollection>
+SearchServer::SearchServer(const StringCollection& stop_words)
+{
+    SetStopWords(stop_words);
+}
+
+template <typename ScoringPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count) const
+{
+    if constexpr (!std::is_same<typename std::decay<ExecutionPolicy>::type, std::execution::parallel_policy>::value)
+    {
+        return FindTopDocuments<ScoringPolicy>(raw_query, document_predicate, max_count);
+    }
+    else
+    {
+        const Query& query = ParseQuery(raw_query);
+        std::vector<Document> matched_documents = FindAllDocuments<ScoringPolicy>(policy, query, document_predicate);
+        SelectTopDocuments(policy, matched_documents, max_count);
         return matched_documents;
     }
 }
 
-template <typename ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status) const
+template <typename ScoringPolicy, typename ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
 {
-    return FindTopDocuments(policy, raw_query, [&status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
+    return FindTopDocuments<ScoringPolicy>(policy, raw_query, [&status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
     {
         return document_status == status;
-    });
+    }, max_count);
 }
 
-template <typename ExecutionPolicy>
+template <typename ScoringPolicy, typename ExecutionPolicy>
 std::vector<Document> SearchServer::FindTopDocuments(const ExecutionPolicy& policy, const std::string_view& raw_query) const
 {
-    return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+    return FindTopDocuments<ScoringPolicy>(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate) const
+template <typename ScoringPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count) const
 {
     const auto query = ParseQuery(raw_query);
-    auto matched_documents = FindAllDocuments(query, document_predicate);
-    sort(matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs)
-    {
-        if (std::abs(lhs.relevance - rhs.relevance) < EPSILON)
-        {
-            return lhs.rating > rhs.rating;
-        }
-        else
-        {
-            return lhs.relevance > rhs.relevance;
-        }
-    });
-
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    if (IsWandQuery(query))
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        QueryScratch scratch;
+        FindTopDocumentsWand<ScoringPolicy>(scratch, query, document_predicate, max_count);
+        return std::move(scratch.matched_documents);
     }
+    auto matched_documents = FindAllDocuments<ScoringPolicy>(query, document_predicate);
+    SelectTopDocuments(std::execution::seq, matched_documents, max_count);
     return matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, DocumentPredicate document_predicate) const
+template <typename ScoringPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return FindTopDocuments<ScoringPolicy>(raw_query, [&status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
+    {
+        return document_status == status;
+    }, max_count);
+}
+
+template <typename ScoringPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query) const
+{
+    return FindTopDocuments<ScoringPolicy>(raw_query, DocumentStatus::ACTUAL);
+}
+
+template <typename ScoringPolicy, typename DocumentPredicate>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryScratch& scratch, const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count) const
 {
-    int num_of_threads = std::thread::hardware_concurrency();
-    if (num_of_threads <= 1)
+    ParseQuery(raw_query, scratch.query, scratch.words);
+    if (IsWandQuery(scratch.query))
     {
-        return FindAllDocuments(query, document_predicate);
+        FindTopDocumentsWand<ScoringPolicy>(scratch, scratch.query, document_predicate, max_count);
+        return scratch.matched_documents;
     }
+    FindAllDocuments<ScoringPolicy>(scratch, document_predicate);
+    SelectTopDocuments(std::execution::seq, scratch.matched_documents, max_count);
+    return scratch.matched_documents;
+}
 
-    ConcurrentMap<int, double> document_to_relevance(num_of_threads);
-    std::for_each(policy, query.plus_words.begin(), query.plus_words.end(), [&](std::string_view word)
+template <typename ScoringPolicy>
+const std::vector<Document>& SearchServer::FindTopDocuments(QueryScratch& scratch, const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return FindTopDocuments<ScoringPolicy>(scratch, raw_query, [&status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
+    {
+        return document_status == status;
+    }, max_count);
+}
+
+// Оставляет в documents только max_count лучших, упорядоченных по релевантности и рейтингу.
+// Полная сортировка не нужна: частичная стоит O(n log k) вместо O(n log n).
+template <typename ExecutionPolicy>
+void SearchServer::SelectTopDocuments([[__maybe_unused__]]const ExecutionPolicy& policy, std::vector<Document>& documents, size_t max_count)
+{
+    if constexpr (std::is_same<typename std::decay<ExecutionPolicy>::type, std::execution::parallel_policy>::value)
     {
-        if (word_to_document_freqs_.count(word) != 0)
+        // каждый поток выбирает лучшие в своей части, затем выбираем из их объединения
+        const size_t chunk_count = std::max(1u, std::thread::hardware_concurrency());
+        if (chunk_count > 1 && documents.size() > 2 * chunk_count * max_count)
         {
-            const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
+            const size_t chunk_size = (documents.size() + chunk_count - 1) / chunk_count;
+            std::vector<size_t> chunk_begins;
+            for (size_t begin = 0; begin < documents.size(); begin += chunk_size)
+            {
+                chunk_begins.push_back(begin);
+            }
 
-            for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+            std::for_each(policy, chunk_begins.begin(), chunk_begins.end(), [&](size_t begin)
             {
-                const auto& document_data = documents_.at(document_id);
-                if (document_predicate(document_id, document_data.status, document_data.rating))
+                const auto chunk_begin = documents.begin() + begin;
+                const auto chunk_end = documents.begin() + std::min(begin + chunk_size, documents.size());
+                const auto chunk_top_end = chunk_begin + std::min<size_t>(max_count, chunk_end - chunk_begin);
+                std::partial_sort(chunk_begin, chunk_top_end, chunk_end, IsMoreRelevant);
+            });
+
+            size_t merged_size = 0;
+            for (const size_t begin : chunk_begins)
+            {
+                const size_t top_size = std::min(max_count, std::min(chunk_size, documents.size() - begin));
+                if (merged_size != begin)
                 {
-                    ConcurrentMap<int, double>::Access val = document_to_relevance[document_id];
-                    val.ref_to_value += term_freq * inverse_document_freq;
+                    std::move(documents.begin() + begin, documents.begin() + begin + top_size, documents.begin() + merged_size);
                 }
+                merged_size += top_size;
             }
+            documents.resize(merged_size);
         }
-    });
+    }
+
+    if (documents.size() > max_count)
+    {
+        std::partial_sort(documents.begin(), documents.begin() + max_count, documents.end(), IsMoreRelevant);
+        documents.resize(max_count);
+    }
+    else
+    {
+        std::sort(documents.begin(), documents.end(), IsMoreRelevant);
+    }
+}
+
+// Пространство номеров документов делится на диапазоны, каждый поток копит релевантность
+// в своём куске плотного массива - блокировки не нужны.
+template <typename ScoringPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindAllDocuments(const std::execution::parallel_policy& policy, const ScoringPolicy& scoring, const Query& query, DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const
+{
+    const size_t num_of_threads = std::thread::hardware_concurrency();
+    if (num_of_threads <= 1 || query.HasRequiredTerms())
+    {
+        return FindAllDocuments(std::execution::seq, scoring, query, document_predicate, inverse_document_freq);
+    }
+
+    const size_t ordinal_count = documents_.size();
+    if (ordinal_count == 0)
+    {
+        return {};
+    }
+
+    std::vector<bool> is_excluded(ordinal_count);
+    for (const TermId term_id : query.minus_terms)
+    {
+        ForEachPosting(term_id, [&is_excluded](DocumentOrdinal ordinal, [[__maybe_unused__]]double term_freq)
+        {
+            is_excluded[ordinal] = true;
+        });
+    }
+
+    std::vector<double> inverse_document_freqs(query.plus_terms.size());
+    for (size_t i = 0; i < query.plus_terms.size(); ++i)
+    {
+        if (postings_[query.plus_terms[i]].GetDocumentFreq() != 0)
+        {
+            inverse_document_freqs[i] = inverse_document_freq(query.plus_terms[i]);
+        }
+    }
+
+    std::vector<double> relevances(ordinal_count);
+    std::vector<char> is_matched(ordinal_count); // релевантность может быть нулевой, если слово есть во всех документах
 
-    std::for_each(policy, query.minus_words.begin(), query.minus_words.end(), [&](std::string_view word)
+    const size_t range_size = (ordinal_count + num_of_threads - 1) / num_of_threads;
+    std::vector<std::vector<Document>> range_documents((ordinal_count + range_size - 1) / range_size);
+    std::vector<size_t> range_indexes(range_documents.size());
+    std::iota(range_indexes.begin(), range_indexes.end(), 0);
+
+    std::for_each(policy, range_indexes.begin(), range_indexes.end(), [&](size_t range_index)
     {
-        if (word_to_document_freqs_.count(word) != 0)
+        const DocumentOrdinal range_begin = range_index * range_size;
+        const DocumentOrdinal range_end = std::min(range_begin + range_size, ordinal_count);
+
+        for (size_t i = 0; i < query.plus_terms.size(); ++i)
+        {
+            const double term_inverse_document_freq = inverse_document_freqs[i];
+            ForEachPosting(query.plus_terms[i], range_begin, range_end, [&](DocumentOrdinal ordinal, double term_freq)
+            {
+                relevances[ordinal] += scoring.Score(term_freq, length_norms_[ordinal], term_inverse_document_freq);
+                is_matched[ordinal] = true;
+            });
+        }
+
+        std::vector<Document>& matched_documents = range_documents[range_index];
+        for (DocumentOrdinal ordinal = range_begin; ordinal < range_end; ++ordinal)
         {
-            for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+            if (!is_matched[ordinal] || is_excluded[ordinal])
             {
-                document_to_relevance.erase(document_id);
+                continue;
+            }
+            const DocumentData& document_data = documents_[ordinal];
+            if (document_predicate(document_data.id, document_data.status, document_data.rating))
+            {
+                matched_documents.push_back({document_data.id, relevances[ordinal], document_data.rating});
             }
         }
     });
 
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap())
+    for (std::vector<Document>& documents : range_documents)
     {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
     }
     return matched_documents;
 }
 
-template<typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments([[__maybe_unused__]]const __pstl::execution::sequenced_policy& policy, const Query &query, DocumentPredicate document_predicate) const
+template <typename ScoringPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindAllDocuments([[__maybe_unused__]]const std::execution::sequenced_policy& policy, const ScoringPolicy& scoring, const Query &query, DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const
 {
-    std::map<int, double> document_to_relevance;
+    if (query.HasRequiredTerms())
+    {
+        return FindConjunctiveDocuments(scoring, query, document_predicate, inverse_document_freq);
+    }
 
-    for (const std::string_view& word : query.plus_words)
+    std::map<DocumentOrdinal, double> document_to_relevance;
+
+    for (const TermId term_id : query.plus_terms)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        const Postings& postings = postings_[term_id];
+        if (postings.GetDocumentFreq() == 0)
         {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word))
+        const double term_inverse_document_freq = inverse_document_freq(term_id);
+
+        ForEachPosting(term_id, [&](DocumentOrdinal ordinal, double term_freq)
         {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating))
+            const auto& document_data = documents_[ordinal];
+            if (document_predicate(document_data.id, document_data.status, document_data.rating))
             {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                document_to_relevance[ordinal] += scoring.Score(term_freq, length_norms_[ordinal], term_inverse_document_freq);
             }
-        }
+        });
     }
 
-    for (const std::string_view& word : query.minus_words)
+    for (const TermId term_id : query.minus_terms)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        ForEachPosting(term_id, [&document_to_relevance](DocumentOrdinal ordinal, [[__maybe_unused__]]double term_freq)
+        {
+            document_to_relevance.erase(ordinal);
+        });
+    }
+
+    std::vector<Document> matched_documents;
+    for (const auto [ordinal, relevance] : document_to_relevance)
+    {
+        const auto& document_data = documents_[ordinal];
+        matched_documents.push_back({document_data.id, relevance, document_data.rating});
+    }
+    return matched_documents;
+}
+
+template <typename ScoringPolicy, typename DocumentPredicate>
+void SearchServer::FindAllDocuments(QueryScratch& scratch, DocumentPredicate document_predicate) const
+{
+    if (scratch.query.HasRequiredTerms())
+    {
+        scratch.matched_documents = FindAllDocuments<ScoringPolicy>(std::execution::seq, scratch.query, document_predicate);
+        return;
+    }
+
+    enum Mark : char
+    {
+        UNTOUCHED,
+        MATCHED,
+        EXCLUDED,
+    };
+
+    if (scratch.relevances.size() < documents_.size())
+    {
+        scratch.relevances.resize(documents_.size());
+        scratch.marks.resize(documents_.size(), UNTOUCHED);
+    }
+    auto& relevances = scratch.relevances;
+    auto& marks = scratch.marks;
+    auto& touched_ordinals = scratch.touched_ordinals;
+    touched_ordinals.clear();
+
+    const ScoringPolicy scoring(GetScoringStatistics());
+    for (const TermId term_id : scratch.query.plus_terms)
+    {
+        if (postings_[term_id].GetDocumentFreq() == 0)
         {
             continue;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word))
+        const double inverse_document_freq = ComputeWordInverseDocumentFreq(scoring, term_id);
+
+        ForEachPosting(term_id, [&](DocumentOrdinal ordinal, double term_freq)
+        {
+            if (marks[ordinal] == UNTOUCHED)
+            {
+                marks[ordinal] = MATCHED;
+                touched_ordinals.push_back(ordinal);
+            }
+            relevances[ordinal] += scoring.Score(term_freq, length_norms_[ordinal], inverse_document_freq);
+        });
+    }
+
+    for (const TermId term_id : scratch.query.minus_terms)
+    {
+        ForEachPosting(term_id, [&](DocumentOrdinal ordinal, [[__maybe_unused__]]double term_freq)
+        {
+            if (marks[ordinal] == UNTOUCHED)
+            {
+                touched_ordinals.push_back(ordinal);
+            }
+            marks[ordinal] = EXCLUDED;
+        });
+    }
+
+    scratch.matched_documents.clear();
+    for (const DocumentOrdinal ordinal : touched_ordinals)
+    {
+        // сначала возвращаем ячейки в ноль, чтобы буфер был чистым даже при исключении из предиката
+        const double relevance = relevances[ordinal];
+        const bool is_matched = marks[ordinal] == MATCHED;
+        relevances[ordinal] = 0.0;
+        marks[ordinal] = UNTOUCHED;
+
+        const DocumentData& document_data = documents_[ordinal];
+        if (is_matched && document_predicate(document_data.id, document_data.status, document_data.rating))
         {
-            document_to_relevance.erase(document_id);
+            scratch.matched_documents.push_back({document_data.id, relevance, document_data.rating});
         }
     }
+}
 
+template <typename ScoringPolicy, typename DocumentPredicate, typename InverseDocumentFreq>
+std::vector<Document> SearchServer::FindConjunctiveDocuments(const ScoringPolicy& scoring, const Query& query, DocumentPredicate document_predicate, InverseDocumentFreq inverse_document_freq) const
+{
+    using namespace std::literals::string_literals;
+    if (!query.phrases.empty() && !has_positions_)
+    {
+        throw std::invalid_argument("Phrase queries need the positional index"s);
+    }
     std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance)
+    if (query.has_unknown_required_word)
+    {
+        return matched_documents;
+    }
+
+    // кандидаты идут по возрастанию номеров, курсоры плюс-слов только догоняют их
+    std::vector<PostingCursor> cursors;
+    cursors.reserve(query.plus_terms.size());
+    for (const TermId term_id : query.plus_terms)
+    {
+        PostingCursor& cursor = cursors.emplace_back(*this, term_id);
+        // слово без живых документов не встретится и у кандидатов
+        if (postings_[term_id].GetDocumentFreq() > 0)
+        {
+            cursor.inverse_document_freq = inverse_document_freq(term_id);
+        }
+    }
+
+    std::vector<TermId> required_terms = query.required_terms;
+    for (const std::vector<TermId>& phrase : query.phrases)
+    {
+        required_terms.insert(required_terms.end(), phrase.begin(), phrase.end());
+    }
+    std::sort(required_terms.begin(), required_terms.end());
+    required_terms.erase(std::unique(required_terms.begin(), required_terms.end()), required_terms.end());
+
+    std::vector<std::vector<uint32_t>> positions(query.phrases.empty() ? 0 : query.plus_terms.size());
+    for (const DocumentOrdinal ordinal : IntersectPostings(std::move(required_terms)))
     {
-        matched_documents.push_back({document_id, relevance, documents_.at(document_id).rating});
+        const DocumentData& document_data = documents_[ordinal];
+        const auto& term_ids = document_data.term_ids;
+        if (std::any_of(query.minus_terms.begin(), query.minus_terms.end(), [&term_ids](TermId term_id)
+            {
+                return std::binary_search(term_ids.begin(), term_ids.end(), term_id);
+            })
+            || !document_predicate(document_data.id, document_data.status, document_data.rating))
+        {
+            continue;
+        }
+
+        if (!query.phrases.empty())
+        {
+            DecodeQueryPositions(ordinal, query, positions);
+            if (!ArePhrasesMatched(query, positions))
+            {
+                continue;
+            }
+        }
+
+        // вклады складываются в порядке слов запроса, как при полном переборе
+        double relevance = 0.0;
+        for (PostingCursor& cursor : cursors)
+        {
+            cursor.Seek(ordinal);
+            if (cursor.GetOrdinal() == ordinal)
+            {
+                relevance += scoring.Score(cursor.GetTermFreq(), length_norms_[ordinal], cursor.inverse_document_freq);
+            }
+        }
+        if (!query.phrases.empty())
+        {
+            relevance *= ComputeProximityBoost(positions);
+        }
+        matched_documents.push_back({ document_data.id, relevance, document_data.rating });
     }
     return matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const
+// Block-max WAND: курсоры упорядочиваются по текущему документу, и их наибольшие вклады складываются,
+// пока сумма не достигнет порога - релевантности худшего из max_count лучших. Документ, на котором это
+// случилось (pivot), - первый, который ещё может войти в ответ. Затем та же сумма считается точнее,
+// по блокам вхождений, где лежит pivot: если порог не набирается, пропускается весь отрезок до конца
+// ближайшего блока. Порог занижен на 2 * EPSILON: документ в пределах EPSILON от худшего сравнивается по рейтингу.
+template <typename ScoringPolicy, typename DocumentPredicate>
+void SearchServer::FindTopDocumentsWand(QueryScratch& scratch, const Query& query, DocumentPredicate document_predicate, size_t max_count) const
 {
-    return FindAllDocuments(std::execution::seq, query, document_predicate);
+    const ScoringPolicy scoring(GetScoringStatistics());
+    // в порядке слов запроса: вклады складываются в том же порядке, что и при полном переборе
+    auto& cursors = scratch.cursors;
+    cursors.clear();
+    for (const TermId term_id : query.plus_terms)
+    {
+        const Postings& postings = postings_[term_id];
+        if (postings.GetDocumentFreq() == 0)
+        {
+            continue;
+        }
+        PostingCursor& cursor = cursors.emplace_back(*this, term_id);
+        cursor.inverse_document_freq = ComputeWordInverseDocumentFreq(scoring, term_id);
+        cursor.max_score = scoring.GetMaxScore(postings.GetMaxTermFreq(), cursor.inverse_document_freq);
+    }
+    auto& minus_cursors = scratch.minus_cursors;
+    minus_cursors.clear();
+    for (const TermId term_id : query.minus_terms)
+    {
+        minus_cursors.emplace_back(*this, term_id);
+    }
+
+    // order упорядочен по номерам документов. Сдвигаются всегда первые курсоры order, и только они
+    // вставляются обратно в упорядоченный хвост: полная сортировка на каждом шаге стоит O(n log n) на документ
+    auto& order = scratch.order;
+    order.clear();
+    for (PostingCursor& cursor : cursors)
+    {
+        order.push_back(&cursor);
+    }
+    const auto by_ordinal = [](const PostingCursor* lhs, const PostingCursor* rhs)
+    {
+        return lhs->GetOrdinal() < rhs->GetOrdinal();
+    };
+    std::sort(order.begin(), order.end(), by_ordinal);
+    const auto restore_order = [&order, &by_ordinal](size_t moved_count)
+    {
+        for (size_t i = moved_count; i-- > 0;)
+        {
+            const auto first = order.begin() + i;
+            std::rotate(first, first + 1, std::upper_bound(first + 1, order.end(), *first, by_ordinal));
+        }
+    };
+
+    auto& matched_documents = scratch.matched_documents;
+    matched_documents.clear();
+    auto& top_relevances = scratch.top_relevances; // куча с худшим из лучших наверху
+    top_relevances.clear();
+    double threshold = -std::numeric_limits<double>::infinity();
+
+    while (max_count > 0)
+    {
+        double score_bound = 0.0;
+        size_t pivot = 0;
+        while (pivot < order.size() && order[pivot]->GetOrdinal() != PostingCursor::END)
+        {
+            score_bound += order[pivot]->max_score;
+            if (score_bound >= threshold)
+            {
+                break;
+            }
+            ++pivot;
+        }
+        if (pivot == order.size() || order[pivot]->GetOrdinal() == PostingCursor::END)
+        {
+            break;
+        }
+
+        const DocumentOrdinal pivot_ordinal = order[pivot]->GetOrdinal();
+        size_t pivot_end = pivot + 1;
+        while (pivot_end < order.size() && order[pivot_end]->GetOrdinal() == pivot_ordinal)
+        {
+            ++pivot_end;
+        }
+
+        if (threshold > 0.0)
+        {
+            double block_score_bound = 0.0;
+            DocumentOrdinal skip_to = pivot_end < order.size() ? order[pivot_end]->GetOrdinal() : PostingCursor::END;
+            for (size_t i = 0; i < pivot_end; ++i)
+            {
+                DocumentOrdinal last_ordinal = PostingCursor::END;
+                block_score_bound += scoring.GetMaxScore(order[i]->GetBlockMaxTermFreq(pivot_ordinal, last_ordinal), order[i]->inverse_document_freq);
+                skip_to = std::min(skip_to, last_ordinal == PostingCursor::END ? last_ordinal : last_ordinal + 1);
+            }
+            if (block_score_bound < threshold)
+            {
+                // до skip_to документы видят только эти слова, и их блоки не дают порога
+                for (size_t i = 0; i < pivot_end; ++i)
+                {
+                    order[i]->Seek(skip_to);
+                }
+                restore_order(pivot_end);
+                continue;
+            }
+        }
+
+        if (order.front()->GetOrdinal() != pivot_ordinal)
+        {
+            size_t moved_count = 0;
+            for (; moved_count < pivot && order[moved_count]->GetOrdinal() < pivot_ordinal; ++moved_count)
+            {
+                order[moved_count]->Seek(pivot_ordinal);
+            }
+            restore_order(moved_count);
+            continue;
+        }
+
+        // на документе стоят ровно первые pivot_end курсоров. Адреса курсоров идут в порядке слов запроса:
+        // вклады складываются в том же порядке, что и при полном переборе, а order остаётся упорядоченным
+        std::sort(order.begin(), order.begin() + pivot_end);
+        double relevance = 0.0;
+        for (size_t i = 0; i < pivot_end; ++i)
+        {
+            relevance += scoring.Score(order[i]->GetTermFreq(), length_norms_[pivot_ordinal], order[i]->inverse_document_freq);
+        }
+
+        const DocumentData& document_data = documents_[pivot_ordinal];
+        if (relevance >= threshold && document_predicate(document_data.id, document_data.status, document_data.rating)
+            && std::none_of(minus_cursors.begin(), minus_cursors.end(), [pivot_ordinal](PostingCursor& cursor)
+            {
+                cursor.Seek(pivot_ordinal);
+                return cursor.GetOrdinal() == pivot_ordinal;
+            }))
+        {
+            matched_documents.push_back({ document_data.id, relevance, document_data.rating });
+            top_relevances.push_back(relevance);
+            std::push_heap(top_relevances.begin(), top_relevances.end(), std::greater<double>());
+            if (top_relevances.size() > max_count)
+            {
+                std::pop_heap(top_relevances.begin(), top_relevances.end(), std::greater<double>());
+                top_relevances.pop_back();
+            }
+            if (top_relevances.size() == max_count)
+            {
+                threshold = top_relevances.front() - 2 * EPSILON;
+            }
+        }
+
+        for (size_t i = 0; i < pivot_end; ++i)
+        {
+            order[i]->Next();
+        }
+        restore_order(pivot_end);
+    }
+
+    // порог только рос: документы, найденные до его повышения, могли отстать
+    matched_documents.erase(std::remove_if(matched_documents.begin(), matched_documents.end(), [threshold](const Document& document)
+    {
+        return document.relevance < threshold;
+    }), matched_documents.end());
+    SelectTopDocuments(std::execution::seq, matched_documents, max_count);
+}
+
+template <typename Callback>
+void SearchServer::ForEachPosting(TermId term_id, DocumentOrdinal range_begin, DocumentOrdinal range_end, Callback callback) const
+{
+    const Postings& postings = postings_[term_id];
+    // пока удалений нет, битовая карта не проверяется
+    const bool has_removed = postings.size() != postings.GetDocumentFreq();
+    const auto is_removed = [this, has_removed](DocumentOrdinal ordinal)
+    {
+        return has_removed && ordinal < is_removed_.size() && is_removed_[ordinal];
+    };
+
+    if (!postings.IsCompressed())
+    {
+        const auto ordinals = postings.GetOrdinals();
+        const auto term_freqs = postings.GetTermFreqs();
+        auto it = range_begin == 0 ? ordinals.begin() : std::lower_bound(ordinals.begin(), ordinals.end(), range_begin);
+
+        for (; it != ordinals.end() && *it < range_end; ++it)
+        {
+            if (!is_removed(*it))
+            {
+                callback(*it, term_freqs[it - ordinals.begin()]);
+            }
+        }
+        return;
+    }
+
+    // блоки декодируются по одному в буферы на стеке
+    const CompressedPostings& compressed = postings.GetCompressed();
+    DocumentOrdinal ordinals[POSTINGS_BLOCK_SIZE];
+    uint32_t counts[POSTINGS_BLOCK_SIZE];
+
+    for (size_t block_index = compressed.FindBlock(range_begin);
+         block_index < compressed.GetBlockCount() && compressed.GetBlock(block_index).first_ordinal < range_end;
+         ++block_index)
+    {
+        const size_t block_size = compressed.DecodeBlock(block_index, ordinals, counts);
+        for (size_t i = 0; i < block_size && ordinals[i] < range_end; ++i)
+        {
+            if (ordinals[i] >= range_begin && !is_removed(ordinals[i]))
+            {
+                callback(ordinals[i], counts[i] * length_norms_[ordinals[i]]);
+            }
+        }
+    }
 }
 
 template <typename ExecutionPolicy>
-SearchServer::Query SearchServer::ParseQuery([[__maybe_unused__]]const ExecutionPolicy& policy, const std::string_view& text,[[__maybe_unused__]] bool SwitchSortAndNoDubs) const
+void SearchServer::CompactPostings(const ExecutionPolicy& policy)
 {
-    Query result;
-    auto& min_words = result.minus_words;
-    auto& pls_words = result.plus_words;
+    if (pending_removals_.empty())
+    {
+        return;
+    }
+    // каждый список перестраивается независимо от остальных
+    const std::vector<TermId> term_ids = CollectPendingRemovalTerms();
+    std::for_each(policy, term_ids.begin(), term_ids.end(), [this](TermId term_id)
+    {
+        RebuildPostings(term_id);
+    });
+    FinishCompaction();
+}
 
-    auto words = SplitIntoWords(text);
+template <typename ExecutionPolicy>
+void SearchServer::RemoveDocuments(const ExecutionPolicy& policy, const std::vector<int>& document_ids)
+{
+    bool is_compaction_due = false;
+    for (const int document_id : document_ids)
+    {
+        is_compaction_due |= MarkDocumentRemoved(document_id);
+    }
+    if (is_compaction_due)
+    {
+        CompactPostings(policy);
+    }
+}
 
-    SortAndRemoveDublicates(words);
+template <typename ExecutionPolicy>
+std::vector<uint32_t> SearchServer::GroupIdenticalTermSets(const ExecutionPolicy& policy, const std::vector<DocumentOrdinal>& ordinals) const
+{
+    std::vector<std::pair<uint64_t, uint32_t>> signatures(ordinals.size());
+    std::transform(policy, ordinals.begin(), ordinals.end(), signatures.begin(), [this, &ordinals](const DocumentOrdinal& ordinal)
+    {
+        return std::make_pair(ComputeTermSetSignature(documents_[ordinal].term_ids), static_cast<uint32_t>(&ordinal - ordinals.data()));
+    });
+    // внутри группы с одной подписью документы идут по возрастанию id
+    std::sort(policy, signatures.begin(), signatures.end());
 
-    for (const std::string_view word : words)
+    std::vector<uint32_t> originals(ordinals.size());
+    std::vector<uint32_t> group_originals;
+    for (auto group_begin = signatures.begin(); group_begin != signatures.end();)
     {
-        const auto& query_word = ParseQueryWord(word);
-        if (!query_word.is_stop)
+        const auto group_end = std::find_if(group_begin, signatures.end(), [group_begin](const auto& signature)
+        {
+            return signature.first != group_begin->first;
+        });
+
+        // совпадение подписей без совпадения наборов маловероятно, но проверяется
+        group_originals.clear();
+        for (auto it = group_begin; it != group_end; ++it)
         {
-            if (query_word.is_minus)
+            const std::vector<TermId>& term_ids = documents_[ordinals[it->second]].term_ids;
+            const auto original = std::find_if(group_originals.begin(), group_originals.end(), [this, &ordinals, &term_ids](uint32_t index)
+            {
+                return documents_[ordinals[index]].term_ids == term_ids;
+            });
+            if (original == group_originals.end())
             {
-                min_words.push_back(query_word.data);
+                group_originals.push_back(it->second);
+                originals[it->second] = it->second;
             }
             else
             {
-                pls_words.push_back(query_word.data);
+                originals[it->second] = *original;
             }
         }
+        group_begin = group_end;
     }
-    return result;
+    return originals;
 }
 
+template <typename ExecutionPolicy>
+std::vector<int> SearchServer::FindDuplicates(const ExecutionPolicy& policy) const
+{
+    const std::vector<DocumentOrdinal> ordinals = GetLiveOrdinals();
+    const std::vector<uint32_t> originals = GroupIdenticalTermSets(policy, ordinals);
+
+    std::vector<int> duplicates;
+    for (uint32_t i = 0; i < originals.size(); ++i)
+    {
+        if (originals[i] != i)
+        {
+            duplicates.push_back(documents_[ordinals[i]].id);
+        }
+    }
+    return duplicates;
+}
+
+template <typename ExecutionPolicy>
+std::vector<std::vector<int>> SearchServer::FindNearDuplicates(const ExecutionPolicy& policy, const NearDuplicateOptions& options) const
+{
+    if (!(options.jaccard_threshold > 0.0 && options.jaccard_threshold <= 1.0) || options.band_count == 0 || options.rows_per_band == 0)
+    {
+        throw std::invalid_argument("Invalid near duplicate options");
+    }
+
+    const std::vector<DocumentOrdinal> ordinals = GetLiveOrdinals();
+    const size_t document_count = ordinals.size();
+
+    // Точные дубликаты сразу попадают в кластер своего оригинала (он же корень: у него меньший id),
+    // по полосам раскладываются только оригиналы - иначе тысячи копий одной страницы дали бы квадрат пар.
+    std::vector<uint32_t> parents = GroupIdenticalTermSets(policy, ordinals);
+    std::vector<uint32_t> originals;
+    for (uint32_t i = 0; i < document_count; ++i)
+    {
+        if (parents[i] == i)
+        {
+            originals.push_back(i);
+        }
+    }
+
+    // band_hashes[band * originals.size() + k] - хеш полосы подписи k-го оригинала
+    std::vector<uint64_t> band_hashes(options.band_count * originals.size());
+    std::for_each(policy, originals.begin(), originals.end(), [&](const uint32_t& index)
+    {
+        ComputeBandHashes(documents_[ordinals[index]].term_ids, options, band_hashes.data() + (&index - originals.data()), originals.size());
+    });
+
+    std::vector<std::pair<uint64_t, uint32_t>> buckets(originals.size());
+    for (size_t band = 0; band < options.band_count; ++band)
+    {
+        for (size_t k = 0; k < originals.size(); ++k)
+        {
+            buckets[k] = { band_hashes[band * originals.size() + k], originals[k] };
+        }
+        std::sort(policy, buckets.begin(), buckets.end());
+
+        for (auto bucket_begin = buckets.begin(); bucket_begin != buckets.end();)
+        {
+            const auto bucket_end = std::find_if(bucket_begin, buckets.end(), [bucket_begin](const auto& bucket)
+            {
+                return bucket.first != bucket_begin->first;
+            });
+            for (auto lhs = bucket_begin; lhs != bucket_end; ++lhs)
+            {
+                for (auto rhs = std::next(lhs); rhs != bucket_end; ++rhs)
+                {
+                    const uint32_t lhs_root = FindClusterRoot(parents, lhs->second);
+                    const uint32_t rhs_root = FindClusterRoot(parents, rhs->second);
+                    if (lhs_root != rhs_root && IsNearDuplicate(documents_[ordinals[lhs->second]].term_ids, documents_[ordinals[rhs->second]].term_ids, options.jaccard_threshold))
+                    {
+                        // корнем остаётся документ с меньшим id
+                        parents[std::max(lhs_root, rhs_root)] = std::min(lhs_root, rhs_root);
+                    }
+                }
+            }
+            bucket_begin = bucket_end;
+        }
+    }
+
+    return CollectClusters(ordinals, parents);
+}
+
+template <typename Callback>
+void SearchServer::ForEachPosting(TermId term_id, Callback callback) const
+{
+    ForEachPosting(term_id, 0, std::numeric_limits<DocumentOrdinal>::max(), callback);
+}
+
+template <typename ScoringPolicy, typename ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const ExecutionPolicy& policy, const Query& query, DocumentPredicate document_predicate) const
+{
+    const ScoringPolicy scoring(GetScoringStatistics());
+    return FindAllDocuments(policy, scoring, query, document_predicate, [this, &scoring](TermId term_id)
+    {
+        return ComputeWordInverseDocumentFreq(scoring, term_id);
+    });
+}
+
+template <typename ScoringPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(const Query& query, DocumentPredicate document_predicate) const
+{
+    return FindAllDocuments<ScoringPolicy>(std::execution::seq, query, document_predicate);
+}
+
+template <typename ScoringPolicy>
+double SearchServer::ComputeWordInverseDocumentFreq(const ScoringPolicy& scoring, TermId term_id) const
+{
+    const Postings& postings = postings_[term_id];
+    return scoring.ComputeInverseDocumentFreq(postings.GetDocumentFreq(), postings.GetLogDocumentFreq());
+}
+
+template <typename ExecutionPolicy>
+SearchServer::Query SearchServer::ParseQuery([[__maybe_unused__]]const ExecutionPolicy& policy, const std::string_view& text,[[__maybe_unused__]] bool SwitchSortAndNoDubs) const
+{
+    Query result;
+    std::vector<std::string_view> words;
+    ParseQuery(text, result, words);
+    return result;
+}
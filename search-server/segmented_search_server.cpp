@@ -0,0 +1,318 @@
+#include "segmented_search_server.h"
+
+//------------------constructors-----------------------//
+
+SegmentedSearchServer::SegmentedSearchServer(const std::string& stop_words, size_t segment_capacity, size_t merge_factor)
+    : SegmentedSearchServer(SplitIntoWords(stop_words), segment_capacity, merge_factor)
+{
+}
+
+SegmentedSearchServer::SegmentedSearchServer(std::string_view stop_words, size_t segment_capacity, size_t merge_factor)
+    : SegmentedSearchServer(SplitIntoWords(stop_words), segment_capacity, merge_factor)
+{
+}
+
+namespace
+{
+// Слова сегмента ссылаются в его словарь, а сегмент может быть слит и удалён
+std::map<std::string, double> CopyWordFrequencies(const std::map<std::string_view, double>& word_freqs)
+{
+    std::map<std::string, double> result;
+    for (const auto& [word, term_freq] : word_freqs)
+    {
+        result.emplace_hint(result.end(), word, term_freq);
+    }
+    return result;
+}
+
+// Слово запроса без синтаксиса: плюса обязательного слова и кавычек фразы
+std::string_view StripQuerySyntax(std::string_view word)
+{
+    if (!word.empty() && word.front() == '+')
+    {
+        word.remove_prefix(1);
+    }
+    if (!word.empty() && word.front() == '"')
+    {
+        word.remove_prefix(1);
+    }
+    if (!word.empty() && word.back() == '"')
+    {
+        word.remove_suffix(1);
+    }
+    return word;
+}
+}
+
+//--------------------private methods------------------//
+
+size_t SegmentedSearchServer::SealedSegment::GetLiveDocumentCount() const
+{
+    return index->GetDocumentCount() - tombstones->document_ids.size();
+}
+
+// Вызывается под блокировкой
+void SegmentedSearchServer::SealMutableSegment()
+{
+    sealed_segments_.push_back({ std::make_shared<const SearchServer>(std::move(mutable_segment_)), std::make_shared<const Tombstones>() });
+    mutable_segment_ = SearchServer(stop_words_);
+    mutable_segment_.SetPositionalIndex(has_positions_);
+
+    merge_pool_.Submit([this]()
+    {
+        MergeSegments();
+    });
+}
+
+// Ярус 0 - до segment_capacity_ документов, каждый следующий в merge_factor_ раз больше
+size_t SegmentedSearchServer::GetTier(const SealedSegment& segment) const
+{
+    size_t tier = 0;
+    for (size_t tier_capacity = segment_capacity_; segment.GetLiveDocumentCount() > tier_capacity; tier_capacity *= merge_factor_)
+    {
+        ++tier;
+    }
+    return tier;
+}
+
+// Вызывается под блокировкой. Возвращает [begin, end) сегментов для слияния: merge_factor_ подряд
+// идущих сегментов одного яруса или один сегмент, в котором удалена половина документов.
+std::optional<std::pair<size_t, size_t>> SegmentedSearchServer::FindMergeCandidate() const
+{
+    for (size_t i = 0; i < sealed_segments_.size(); ++i)
+    {
+        const SealedSegment& segment = sealed_segments_[i];
+        if (!segment.tombstones->document_ids.empty() && 2 * segment.tombstones->document_ids.size() >= segment.index->GetDocumentCount())
+        {
+            return std::make_pair(i, i + 1);
+        }
+    }
+
+    for (size_t begin = 0; begin + merge_factor_ <= sealed_segments_.size(); ++begin)
+    {
+        const size_t tier = GetTier(sealed_segments_[begin]);
+        const auto end = sealed_segments_.begin() + begin + merge_factor_;
+        if (std::all_of(sealed_segments_.begin() + begin, end, [this, tier](const SealedSegment& segment)
+        {
+            return GetTier(segment) == tier;
+        }))
+        {
+            return std::make_pair(begin, begin + merge_factor_);
+        }
+    }
+    return std::nullopt;
+}
+
+// Выполняется в фоновом потоке. Новый сегмент строится без блокировки, под блокировкой
+// только подменяются указатели, поэтому запросы и добавление документов не ждут слияния.
+void SegmentedSearchServer::MergeSegments()
+{
+    while (true)
+    {
+        std::vector<SealedSegment> sources;
+        bool has_positions = false;
+        {
+            std::lock_guard<std::mutex> guard(m_);
+            const auto candidate = FindMergeCandidate();
+            if (!candidate)
+            {
+                return;
+            }
+            sources.assign(sealed_segments_.begin() + candidate->first, sealed_segments_.begin() + candidate->second);
+            has_positions = has_positions_;
+        }
+
+        auto merged = std::make_shared<SearchServer>(stop_words_);
+        merged->SetPositionalIndex(has_positions);
+        for (const SealedSegment& source : sources)
+        {
+            merged->MergeDocumentsFrom(*source.index, source.tombstones->document_ids);
+        }
+        SealedSegment merged_segment{ merged, std::make_shared<const Tombstones>() };
+
+        std::lock_guard<std::mutex> guard(m_);
+        // сливает только этот поток, поэтому сегменты на месте, но могли добавиться удаления
+        const auto begin = std::find_if(sealed_segments_.begin(), sealed_segments_.end(), [&sources](const SealedSegment& segment)
+        {
+            return segment.index == sources.front().index;
+        });
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            for (const int document_id : (begin + i)->tombstones->document_ids)
+            {
+                if (sources[i].tombstones->document_ids.count(document_id) == 0)
+                {
+                    merged_segment.tombstones = AddTombstone(merged_segment, *merged_segment.tombstones, document_id);
+                }
+            }
+        }
+        const auto end = sealed_segments_.erase(begin + 1, begin + sources.size());
+        *std::prev(end) = std::move(merged_segment);
+    }
+}
+
+std::shared_ptr<const SegmentedSearchServer::Tombstones> SegmentedSearchServer::AddTombstone(const SealedSegment& segment, const Tombstones& tombstones, int document_id)
+{
+    auto updated = std::make_shared<Tombstones>(tombstones);
+    updated->document_ids.insert(document_id);
+    updated->word_count += segment.index->documents_[*segment.index->FindOrdinal(document_id)].word_count;
+    for (const auto& [word, term_freq] : segment.index->GetWordFrequencies(document_id))
+    {
+        auto it = updated->document_freqs.find(word);
+        if (it == updated->document_freqs.end())
+        {
+            it = updated->document_freqs.emplace(std::string(word), 0).first;
+        }
+        ++it->second;
+    }
+    return updated;
+}
+
+//--------------------public methods------------------//
+
+void SegmentedSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    using namespace std::literals::string_literals;
+
+    std::lock_guard<std::mutex> guard(m_);
+    if (document_ids_.count(document_id) > 0)
+    {
+        throw std::invalid_argument( "Document with such ID"s + std::to_string(document_id)  + "already exists" );
+    }
+
+    mutable_segment_.AddDocument(document_id, document, status, ratings);
+    document_ids_.insert(document_id);
+
+    if (mutable_segment_.GetDocumentCount() >= segment_capacity_)
+    {
+        SealMutableSegment();
+    }
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return FindTopDocuments<TfIdfScoring>(raw_query, status, max_count);
+}
+
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view& raw_query) const
+{
+    return FindTopDocuments<TfIdfScoring>(raw_query);
+}
+
+SearchServer::MatchDocumentResult SegmentedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    SearchServer::MatchDocumentResult result;
+    {
+        std::lock_guard<std::mutex> guard(m_);
+        if (document_ids_.count(document_id) == 0)
+        {
+            throw std::out_of_range("Document out of range");
+        }
+
+        if (mutable_segment_.FindOrdinal(document_id))
+        {
+            result = mutable_segment_.MatchDocument(raw_query, document_id);
+        }
+        else
+        {
+            const auto it = std::find_if(sealed_segments_.begin(), sealed_segments_.end(), [document_id](const SealedSegment& segment)
+            {
+                return segment.index->FindOrdinal(document_id) && segment.tombstones->document_ids.count(document_id) == 0;
+            });
+            result = it->index->MatchDocument(raw_query, document_id);
+        }
+    }
+
+    // слова из сегмента заменяются теми же словами из запроса: сегмент может быть слит и удалён
+    std::vector<std::string_view> query_words = SplitIntoWords(raw_query);
+    std::transform(query_words.begin(), query_words.end(), query_words.begin(), StripQuerySyntax);
+    for (std::string_view& word : std::get<0>(result))
+    {
+        word = *std::find(query_words.begin(), query_words.end(), word);
+    }
+    return result;
+}
+
+void SegmentedSearchServer::RemoveDocument(int document_id)
+{
+    std::lock_guard<std::mutex> guard(m_);
+    if (document_ids_.erase(document_id) == 0)
+    {
+        return;
+    }
+
+    if (mutable_segment_.FindOrdinal(document_id))
+    {
+        mutable_segment_.RemoveDocument(document_id);
+        return;
+    }
+
+    for (SealedSegment& segment : sealed_segments_)
+    {
+        if (segment.index->FindOrdinal(document_id) && segment.tombstones->document_ids.count(document_id) == 0)
+        {
+            segment.tombstones = AddTombstone(segment, *segment.tombstones, document_id);
+            if (2 * segment.tombstones->document_ids.size() >= segment.index->GetDocumentCount())
+            {
+                merge_pool_.Submit([this]()
+                {
+                    MergeSegments();
+                });
+            }
+            return;
+        }
+    }
+}
+
+void SegmentedSearchServer::SetPositionalIndex(bool enabled)
+{
+    using namespace std::literals::string_literals;
+
+    std::lock_guard<std::mutex> guard(m_);
+    // запечатанные сегменты могут остаться и после удаления всех документов
+    if (enabled != has_positions_ && (!document_ids_.empty() || !sealed_segments_.empty()))
+    {
+        throw std::invalid_argument("Positional index can be changed only before adding documents"s);
+    }
+    mutable_segment_.SetPositionalIndex(enabled);
+    has_positions_ = enabled;
+}
+
+void SegmentedSearchServer::WaitForMerges()
+{
+    // пул из одного потока выполняет задачи по порядку
+    merge_pool_.Submit([]() {}).get();
+}
+
+size_t SegmentedSearchServer::GetDocumentCount() const
+{
+    std::lock_guard<std::mutex> guard(m_);
+    return document_ids_.size();
+}
+
+size_t SegmentedSearchServer::GetSegmentCount() const
+{
+    std::lock_guard<std::mutex> guard(m_);
+    return sealed_segments_.size();
+}
+
+std::map<std::string, double> SegmentedSearchServer::GetWordFrequencies(int document_id) const
+{
+    std::lock_guard<std::mutex> guard(m_);
+    if (document_ids_.count(document_id) == 0)
+    {
+        return {};
+    }
+    if (mutable_segment_.FindOrdinal(document_id))
+    {
+        return CopyWordFrequencies(mutable_segment_.GetWordFrequencies(document_id));
+    }
+    for (const SealedSegment& segment : sealed_segments_)
+    {
+        if (segment.index->FindOrdinal(document_id) && segment.tombstones->document_ids.count(document_id) == 0)
+        {
+            return CopyWordFrequencies(segment.index->GetWordFrequencies(document_id));
+        }
+    }
+    return {};
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "search_server.h"
+#include "thread_pool.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+const size_t DEFAULT_SEGMENT_CAPACITY = 4096;
+const size_t DEFAULT_MERGE_FACTOR = 4;
+
+// Индекс из сегментов в духе LSM. Новые документы попадают в небольшой изменяемый сегмент,
+// заполненный сегмент запечатывается и больше не меняется. Фоновый поток сливает подряд идущие
+// сегменты одного яруса и вычищает удалённые документы. Запрос выполняется по всем сегментам
+// с IDF по всей коллекции, поэтому результат совпадает с поиском по одному SearchServer.
+// Все методы потокобезопасны; запечатанные сегменты ищутся без блокировки.
+class SegmentedSearchServer
+{
+private:
+    // Удалённые из запечатанного сегмента документы. Не меняется после публикации: удаление создаёт копию
+    struct Tombstones
+    {
+        std::set<int> document_ids;
+        std::map<std::string, size_t, std::less<>> document_freqs; // сколько удалённых документов содержат слово
+        uint64_t word_count = 0; // суммарная длина удалённых документов
+    };
+
+    struct SealedSegment
+    {
+        std::shared_ptr<const SearchServer> index;
+        std::shared_ptr<const Tombstones> tombstones;
+
+        size_t GetLiveDocumentCount() const;
+    };
+
+    std::vector<std::string> stop_words_;
+    size_t segment_capacity_;
+    size_t merge_factor_;
+    bool has_positions_ = false;
+
+    mutable std::mutex m_;
+    SearchServer mutable_segment_;
+    std::vector<SealedSegment> sealed_segments_; // от старых к новым
+    std::set<int> document_ids_;
+
+    // объявлен последним: при разрушении сначала дожидается фоновых слияний
+    ThreadPool merge_pool_;
+
+    void SealMutableSegment();
+    std::optional<std::pair<size_t, size_t>> FindMergeCandidate() const;
+    void MergeSegments();
+    size_t GetTier(const SealedSegment& segment) const;
+    static std::shared_ptr<const Tombstones> AddTombstone(const SealedSegment& segment, const Tombstones& tombstones, int document_id);
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    template <typename StringCollection>
+    explicit SegmentedSearchServer(const StringCollection& stop_words, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY, size_t merge_factor = DEFAULT_MERGE_FACTOR);
+    explicit SegmentedSearchServer(const std::string& stop_words, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY, size_t merge_factor = DEFAULT_MERGE_FACTOR);
+    explicit SegmentedSearchServer(std::string_view stop_words, size_t segment_capacity = DEFAULT_SEGMENT_CAPACITY, size_t merge_factor = DEFAULT_MERGE_FACTOR);
+
+    //------------------METHODS-----------------//
+    void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // ScoringPolicy - формула релевантности, как у SearchServer::FindTopDocuments; статистика берётся по живым документам всех сегментов
+    template <typename ScoringPolicy = TfIdfScoring, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+    // Найденные слова ссылаются на raw_query: сегмент документа может быть слит и удалён
+    SearchServer::MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+    // Позиционный индекс во всех сегментах, для фраз в кавычках; включается только до добавления документов
+    void SetPositionalIndex(bool enabled);
+
+    // Дожидается завершения запланированных слияний
+    void WaitForMerges();
+
+    //------------------GETS-----------------//
+    size_t GetDocumentCount() const;
+    // Число запечатанных сегментов, изменяемый не учитывается
+    size_t GetSegmentCount() const;
+    // Возвращает копию: сегмент документа может быть слит и удалён
+    std::map<std::string, double> GetWordFrequencies(int document_id) const;
+};
+
+template <typename StringCollection>
+SegmentedSearchServer::SegmentedSearchServer(const StringCollection& stop_words, size_t segment_capacity, size_t merge_factor)
+    : stop_words_(stop_words.begin(), stop_words.end())
+    , segment_capacity_(segment_capacity)
+    , merge_factor_(merge_factor)
+    , mutable_segment_(stop_words)
+    , merge_pool_(1)
+{
+    if (segment_capacity_ == 0)
+    {
+        throw std::invalid_argument("Segment capacity must be positive");
+    }
+    if (merge_factor_ < 2)
+    {
+        throw std::invalid_argument("Merge factor must be at least 2");
+    }
+}
+
+template <typename ScoringPolicy, typename DocumentPredicate>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count) const
+{
+    // у каждого сегмента свои TermId, поэтому запрос разбирается в каждом, а частоты сводятся по словам
+    std::vector<SealedSegment> segments;
+    std::vector<SearchServer::Query> queries;
+    std::map<std::string, size_t, std::less<>> document_freqs;
+
+    std::unique_lock<std::mutex> lock(m_);
+    segments = sealed_segments_;
+
+    // IDF и средняя длина документа считаются той же политикой, что и в одном SearchServer, но по живым документам всех сегментов
+    uint64_t total_word_count = mutable_segment_.total_word_count_;
+    for (const SealedSegment& segment : segments)
+    {
+        total_word_count += segment.index->total_word_count_ - segment.tombstones->word_count;
+    }
+    const ScoringPolicy scoring(MakeScoringStatistics(document_ids_.size(), total_word_count));
+
+    const auto compute_idf = [&document_freqs, &scoring](std::string_view word)
+    {
+        const size_t document_freq = document_freqs.find(word)->second;
+        // слово могло остаться только в удалённых документах, они всё равно будут отброшены
+        return document_freq == 0 ? 0.0 : scoring.ComputeInverseDocumentFreq(document_freq, ComputeLogDocumentFreq(document_freq));
+    };
+
+    queries.reserve(segments.size());
+    for (const SealedSegment& segment : segments)
+    {
+        queries.push_back(segment.index->ParseQuery(raw_query));
+        for (const TermId term_id : queries.back().plus_terms)
+        {
+            const std::string_view word = segment.index->terms_.GetTerm(term_id);
+            const auto removed_it = segment.tombstones->document_freqs.find(word);
+            const size_t removed_count = removed_it == segment.tombstones->document_freqs.end() ? 0 : removed_it->second;
+
+            auto it = document_freqs.find(word);
+            if (it == document_freqs.end())
+            {
+                it = document_freqs.emplace(std::string(word), 0).first;
+            }
+            it->second += segment.index->postings_[term_id].GetDocumentFreq() - removed_count;
+        }
+    }
+
+    // изменяемый сегмент мал, его просматриваем под блокировкой
+    const SearchServer::Query mutable_query = mutable_segment_.ParseQuery(raw_query);
+    for (const TermId term_id : mutable_query.plus_terms)
+    {
+        const std::string_view word = mutable_segment_.terms_.GetTerm(term_id);
+        auto it = document_freqs.find(word);
+        if (it == document_freqs.end())
+        {
+            it = document_freqs.emplace(std::string(word), 0).first;
+        }
+        it->second += mutable_segment_.postings_[term_id].GetDocumentFreq();
+    }
+
+    std::vector<Document> matched_documents = mutable_segment_.FindAllDocuments(std::execution::seq, scoring, mutable_query, document_predicate,
+    [&](TermId term_id)
+    {
+        return compute_idf(mutable_segment_.terms_.GetTerm(term_id));
+    });
+    SearchServer::SelectTopDocuments(std::execution::seq, matched_documents, max_count);
+    lock.unlock();
+
+    std::vector<size_t> indexes(segments.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::vector<std::vector<Document>> segment_results(segments.size());
+    std::transform(std::execution::par, indexes.begin(), indexes.end(), segment_results.begin(), [&](size_t i)
+    {
+        const SearchServer& index = *segments[i].index;
+        const Tombstones& tombstones = *segments[i].tombstones;
+        std::vector<Document> documents = index.FindAllDocuments(std::execution::seq, scoring, queries[i],
+        [&](int document_id, DocumentStatus status, int rating)
+        {
+            return tombstones.document_ids.count(document_id) == 0 && document_predicate(document_id, status, rating);
+        },
+        [&](TermId term_id)
+        {
+            return compute_idf(index.terms_.GetTerm(term_id));
+        });
+        SearchServer::SelectTopDocuments(std::execution::seq, documents, max_count);
+        return documents;
+    });
+
+    for (const std::vector<Document>& documents : segment_results)
+    {
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    SearchServer::SelectTopDocuments(std::execution::seq, matched_documents, max_count);
+    return matched_documents;
+}
+
+template <typename ScoringPolicy>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return FindTopDocuments<ScoringPolicy>(raw_query, [&status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
+    {
+        return document_status == status;
+    }, max_count);
+}
+
+template <typename ScoringPolicy>
+std::vector<Document> SegmentedSearchServer::FindTopDocuments(const std::string_view& raw_query) const
+{
+    return FindTopDocuments<ScoringPolicy>(raw_query, DocumentStatus::ACTUAL);
+}
@@ -0,0 +1,87 @@
+#include "sharded_search_server.h"
+
+//------------------constructors-----------------------//
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const std::string& stop_words)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words))
+{
+}
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, std::string_view stop_words)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words))
+{
+}
+
+//--------------------private methods------------------//
+
+SearchServer& ShardedSearchServer::GetShard(int document_id)
+{
+    return shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+const SearchServer& ShardedSearchServer::GetShard(int document_id) const
+{
+    return shards_[static_cast<size_t>(document_id) % shards_.size()];
+}
+
+//--------------------public methods------------------//
+
+void ShardedSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    using namespace std::literals::string_literals;
+    if (document_id < 0)
+    {
+        throw std::invalid_argument( "Document id "s + std::to_string(document_id) + " is invalid (is negative)" );
+    }
+
+    GetShard(document_id).AddDocument(document_id, document, status, ratings);
+    document_ids_.insert(document_id);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return FindTopDocuments<TfIdfScoring>(raw_query, status, max_count);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query) const
+{
+    return FindTopDocuments<TfIdfScoring>(raw_query);
+}
+
+SearchServer::MatchDocumentResult ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const
+{
+    if (document_id < 0)
+    {
+        throw std::out_of_range("Document out of range");
+    }
+    // у шарда свой словарь, но MatchDocument зависит только от слов документа, поэтому слова из чужих шардов не нужны
+    return GetShard(document_id).MatchDocument(raw_query, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    if (document_ids_.erase(document_id) == 0)
+    {
+        return;
+    }
+    GetShard(document_id).RemoveDocument(document_id);
+}
+
+size_t ShardedSearchServer::GetDocumentCount() const
+{
+    return document_ids_.size();
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+std::map<std::string_view, double> ShardedSearchServer::GetWordFrequencies(int document_id) const
+{
+    if (document_id < 0)
+    {
+        return {};
+    }
+    return GetShard(document_id).GetWordFrequencies(document_id);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "search_server.h"
+#include "thread_pool.h"
+
+#include <future>
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Индекс, разбитый по id документов на несколько SearchServer. Запрос выполняется во всех шардах
+// параллельно, лучшие документы шардов объединяются. IDF считается по всей коллекции,
+// поэтому результат совпадает с поиском по одному SearchServer.
+class ShardedSearchServer
+{
+private:
+    std::vector<SearchServer> shards_;
+    std::set<int> document_ids_;
+    mutable ThreadPool thread_pool_;
+
+    SearchServer& GetShard(int document_id);
+    const SearchServer& GetShard(int document_id) const;
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    template <typename StringCollection>
+    ShardedSearchServer(size_t shard_count, const StringCollection& stop_words);
+    ShardedSearchServer(size_t shard_count, const std::string& stop_words);
+    ShardedSearchServer(size_t shard_count, std::string_view stop_words);
+
+    //------------------METHODS-----------------//
+    void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // ScoringPolicy - формула релевантности, как у SearchServer::FindTopDocuments; статистика берётся по всем шардам
+    template <typename ScoringPolicy = TfIdfScoring, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    template <typename ScoringPolicy>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+    SearchServer::MatchDocumentResult MatchDocument(std::string_view raw_query, int document_id) const;
+
+    void RemoveDocument(int document_id);
+
+    //------------------GETS-----------------//
+    size_t GetDocumentCount() const;
+    size_t GetShardCount() const;
+    std::map<std::string_view, double> GetWordFrequencies(int document_id) const;
+
+    //------------------ITERATORS-----------------//
+    auto begin() const
+    {
+        return document_ids_.begin();
+    }
+
+    auto end() const
+    {
+        return document_ids_.end();
+    }
+};
+
+template <typename StringCollection>
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, const StringCollection& stop_words)
+    : thread_pool_(shard_count)
+{
+    if (shard_count == 0)
+    {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        shards_.emplace_back(stop_words);
+    }
+}
+
+template <typename ScoringPolicy, typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count) const
+{
+    // у каждого шарда свои TermId, поэтому запрос разбирается в каждом, а частоты сводятся по словам
+    std::vector<SearchServer::Query> queries;
+    queries.reserve(shards_.size());
+    std::map<std::string_view, size_t> document_freqs;
+    uint64_t total_word_count = 0;
+
+    for (const SearchServer& shard : shards_)
+    {
+        queries.push_back(shard.ParseQuery(raw_query));
+        for (const TermId term_id : queries.back().plus_terms)
+        {
+            document_freqs[shard.terms_.GetTerm(term_id)] += shard.postings_[term_id].GetDocumentFreq();
+        }
+        total_word_count += shard.total_word_count_;
+    }
+
+    // IDF и средняя длина документа считаются той же политикой, что и в одном SearchServer, но по всей коллекции
+    const ScoringPolicy scoring(MakeScoringStatistics(GetDocumentCount(), total_word_count));
+    std::vector<std::future<std::vector<Document>>> shard_results;
+    shard_results.reserve(shards_.size());
+
+    for (size_t i = 0; i < shards_.size(); ++i)
+    {
+        shard_results.push_back(thread_pool_.Submit([&, i]()
+        {
+            const SearchServer& shard = shards_[i];
+            std::vector<Document> matched_documents = shard.FindAllDocuments(std::execution::seq, scoring, queries[i], document_predicate,
+            [&](TermId term_id)
+            {
+                const size_t document_freq = document_freqs.at(shard.terms_.GetTerm(term_id));
+                return scoring.ComputeInverseDocumentFreq(document_freq, ComputeLogDocumentFreq(document_freq));
+            });
+            SearchServer::SelectTopDocuments(std::execution::seq, matched_documents, max_count);
+            return matched_documents;
+        }));
+    }
+
+    std::vector<Document> matched_documents;
+    for (auto& shard_result : shard_results)
+    {
+        const std::vector<Document> documents = shard_result.get();
+        matched_documents.insert(matched_documents.end(), documents.begin(), documents.end());
+    }
+    SearchServer::SelectTopDocuments(std::execution::seq, matched_documents, max_count);
+    return matched_documents;
+}
+
+template <typename ScoringPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return FindTopDocuments<ScoringPolicy>(raw_query, [&status]([[__maybe_unused__]]int document_id, DocumentStatus document_status,[[__maybe_unused__]] int rating)
+    {
+        return document_status == status;
+    }, max_count);
+}
+
+template <typename ScoringPolicy>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(const std::string_view& raw_query) const
+{
+    return FindTopDocuments<ScoringPolicy>(raw_query, DocumentStatus::ACTUAL);
+}
@@ -1,31 +1,107 @@
 #include "string_processing.h"
 
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#define SEARCH_SERVER_SIMD_TOKENIZER
+#endif
+
+namespace
+{
+    bool IsControlChar(char c)
+    {
+        return c >= '\0' && c < ' ';
+    }
+
+    void PushWord(std::string_view text, size_t word_begin, size_t word_end, std::vector<std::string_view>& words)
+    {
+        if (word_begin != word_end)
+        {
+            words.push_back(text.substr(word_begin, word_end - word_begin));
+        }
+    }
+
+#ifdef SEARCH_SERVER_SIMD_TOKENIZER
+    // Маски пробелов и управляющих символов для блока из BLOCK_SIZE байт: бит i соответствует text[pos + i]
+#ifdef __AVX2__
+    constexpr size_t BLOCK_SIZE = 32;
+
+    void ClassifyBlock(const char* data, uint32_t& space_mask, uint32_t& control_mask)
+    {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+        const __m256i spaces = _mm256_cmpeq_epi8(block, _mm256_set1_epi8(' '));
+        // char знаковый: управляющие - это 0 <= c < 32
+        const __m256i controls = _mm256_and_si256(_mm256_cmpgt_epi8(block, _mm256_set1_epi8(-1)),
+                                                  _mm256_cmpgt_epi8(_mm256_set1_epi8(' '), block));
+        space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(spaces));
+        control_mask = static_cast<uint32_t>(_mm256_movemask_epi8(controls));
+    }
+#else
+    constexpr size_t BLOCK_SIZE = 16;
+
+    void ClassifyBlock(const char* data, uint32_t& space_mask, uint32_t& control_mask)
+    {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i spaces = _mm_cmpeq_epi8(block, _mm_set1_epi8(' '));
+        // char знаковый: управляющие - это 0 <= c < 32
+        const __m128i controls = _mm_and_si128(_mm_cmpgt_epi8(block, _mm_set1_epi8(-1)),
+                                               _mm_cmplt_epi8(block, _mm_set1_epi8(' ')));
+        space_mask = static_cast<uint32_t>(_mm_movemask_epi8(spaces));
+        control_mask = static_cast<uint32_t>(_mm_movemask_epi8(controls));
+    }
+#endif
+#endif
+}
+
 std::vector<std::string_view> SplitIntoWords(std::string_view text)
 {
     std::vector<std::string_view> words;
+    SplitIntoWords(text, words);
+    return words;
+}
 
-    auto word_begin_iter = text.begin();
-    auto word_end_iter = text.end();
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words)
+{
+    words.clear();
 
+    size_t word_begin = 0;
+    size_t pos = 0;
+    bool has_control_chars = false;
 
-    for (auto i = text.begin(); i < text.end(); ++i)
+#ifdef SEARCH_SERVER_SIMD_TOKENIZER
+    for (; pos + BLOCK_SIZE <= text.size(); pos += BLOCK_SIZE)
     {
-        if (*i == ' ')
+        uint32_t space_mask = 0;
+        uint32_t control_mask = 0;
+        ClassifyBlock(text.data() + pos, space_mask, control_mask);
+        has_control_chars |= control_mask != 0;
+
+        // перебираем только позиции пробелов
+        while (space_mask != 0)
         {
-            word_end_iter = i;
-            if (*word_begin_iter != ' ' && word_begin_iter != word_end_iter)
-            {
-                words.push_back(text.substr(
-                    std::distance(text.begin(), word_begin_iter),
-                    std::distance(word_begin_iter, word_end_iter)));
-            }
-            word_begin_iter = std::next(word_end_iter);
+            const size_t space_pos = pos + static_cast<size_t>(__builtin_ctz(space_mask));
+            space_mask &= space_mask - 1;
+            PushWord(text, word_begin, space_pos, words);
+            word_begin = space_pos + 1;
         }
     }
-    if (word_begin_iter != word_end_iter)
+#endif
+
+    // хвост короче блока или вся строка без SIMD
+    for (; pos < text.size(); ++pos)
     {
-        words.push_back(text.substr(word_begin_iter - text.begin(),
-            std::distance(word_begin_iter, word_end_iter)));
+        if (text[pos] == ' ')
+        {
+            PushWord(text, word_begin, pos, words);
+            word_begin = pos + 1;
+        }
+        else if (IsControlChar(text[pos]))
+        {
+            has_control_chars = true;
+        }
     }
-    return words;
+    PushWord(text, word_begin, text.size(), words);
+
+    return !has_control_chars;
 }
@@ -1,6 +1,12 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 std::vector<std::string_view> SplitIntoWords(std::string_view text);
+
+// Разбивает text по пробелам в words за один проход без выделения памяти: буфер очищается,
+// его ёмкость переиспользуется. Одновременно проверяет управляющие символы (коды 0-31).
+// Возвращает false, если хотя бы одно слово содержит такой символ.
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
@@ -0,0 +1,83 @@
+#include "term_dictionary.h"
+
+#include <algorithm>
+
+TermDictionary::TermDictionary(const TermDictionary& other)
+{
+    // слова и ключи должны ссылаться на собственные куски, а не на куски other
+    terms_.reserve(other.terms_.size());
+    ids_.reserve(other.terms_.size());
+    for (const std::string_view word : other.terms_)
+    {
+        terms_.push_back(Store(word));
+        ids_.emplace(terms_.back(), static_cast<TermId>(terms_.size() - 1));
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other)
+{
+    if (this != &other)
+    {
+        TermDictionary copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+TermId TermDictionary::Add(std::string_view word)
+{
+    const auto it = ids_.find(word);
+    if (it != ids_.end())
+    {
+        return it->second;
+    }
+
+    const TermId term_id = static_cast<TermId>(terms_.size());
+    terms_.push_back(Store(word));
+    ids_.emplace(terms_.back(), term_id);
+    return term_id;
+}
+
+std::string_view TermDictionary::Store(std::string_view word)
+{
+    if (word.size() > TERM_ARENA_CHUNK_SIZE / 4)
+    {
+        // длинное слово получает свой кусок, а недозаполненный последний остаётся последним
+        auto chunk = std::make_unique<char[]>(word.size());
+        std::copy(word.begin(), word.end(), chunk.get());
+        const std::string_view stored(chunk.get(), word.size());
+        chunks_.insert(chunks_.empty() ? chunks_.end() : chunks_.end() - 1, std::move(chunk));
+        return stored;
+    }
+
+    if (chunks_.empty() || chunk_capacity_ - chunk_used_ < word.size())
+    {
+        chunks_.push_back(std::make_unique<char[]>(TERM_ARENA_CHUNK_SIZE));
+        chunk_used_ = 0;
+        chunk_capacity_ = TERM_ARENA_CHUNK_SIZE;
+    }
+    char* const data = chunks_.back().get() + chunk_used_;
+    std::copy(word.begin(), word.end(), data);
+    chunk_used_ += word.size();
+    return std::string_view(data, word.size());
+}
+
+std::optional<TermId> TermDictionary::Find(std::string_view word) const
+{
+    const auto it = ids_.find(word);
+    if (it == ids_.end())
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::string_view TermDictionary::GetTerm(TermId term_id) const
+{
+    return terms_[term_id];
+}
+
+size_t TermDictionary::size() const
+{
+    return terms_.size();
+}
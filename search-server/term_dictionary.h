@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using TermId = uint32_t;
+
+const size_t TERM_ARENA_CHUNK_SIZE = 64 * 1024;
+
+// Словарь терминов: каждое различное слово хранится один раз и получает плотный id.
+class TermDictionary
+{
+private:
+    // Символы слов лежат подряд в кусках по TERM_ARENA_CHUNK_SIZE байт: одно выделение памяти на тысячи
+    // слов вместо строки на слово. Куски не перемещаются, на них смотрят terms_ и ключи ids_.
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunk_used_ = 0; // занято в последнем куске
+    size_t chunk_capacity_ = 0;
+    std::vector<std::string_view> terms_;
+    std::unordered_map<std::string_view, TermId> ids_;
+
+    std::string_view Store(std::string_view word);
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    TermDictionary() = default;
+    TermDictionary(const TermDictionary& other);
+    TermDictionary(TermDictionary&& other) = default;
+
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary& operator=(TermDictionary&& other) = default;
+
+    //------------------METHODS-----------------//
+    TermId Add(std::string_view word);
+    std::optional<TermId> Find(std::string_view word) const;
+
+    //------------------GETS-----------------//
+    std::string_view GetTerm(TermId term_id) const;
+    size_t size() const;
+};
@@ -239,3 +239,913 @@ void TestCorrectRelevanceCount() {
         ASSERT (doc0.relevance > doc1.relevance || doc0.rating > doc1.rating);
     }
 }
+
+void TestShardedSearchMatchesSingleServer()
+{
+    const std::vector<std::string> documents = {
+        "белый кот и модный ошейник"s,
+        "пушистый кот пушистый хвост"s,
+        "ухоженный пёс выразительные глаза"s,
+        "ухоженный скворец евгений"s,
+        "пушистый пёс и белый хвост"s,
+        "модный скворец"s,
+        "кот кот кот"s,
+    };
+
+    SearchServer server("и в на"s);
+    ShardedSearchServer sharded_server(3, "и в на"s);
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i)});
+        sharded_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i)});
+    }
+    ASSERT_EQUAL(sharded_server.GetDocumentCount(), server.GetDocumentCount());
+
+    for (const std::string& query : {"пушистый ухоженный кот"s, "модный -ошейник"s, "белый пёс хвост"s, "кот"s})
+    {
+        const auto expected = server.FindTopDocuments(query);
+        const auto found_docs = sharded_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(found_docs.size(), expected.size(), query);
+        for (size_t i = 0; i < found_docs.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_docs[i].id, expected[i].id, query);
+            ASSERT_HINT(std::abs(found_docs[i].relevance - expected[i].relevance) < 1e-6, query);
+        }
+
+        // BM25 зависит ещё и от средней длины документа, она тоже должна считаться по всем шардам
+        const auto expected_bm25 = server.FindTopDocuments<Bm25Scoring>(query);
+        const auto found_bm25 = sharded_server.FindTopDocuments<Bm25Scoring>(query);
+        ASSERT_EQUAL_HINT(found_bm25.size(), expected_bm25.size(), query);
+        for (size_t i = 0; i < found_bm25.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_bm25[i].id, expected_bm25[i].id, query);
+            ASSERT_HINT(std::abs(found_bm25[i].relevance - expected_bm25[i].relevance) < 1e-6, query);
+        }
+    }
+
+    // шард - id % 3: в словаре шарда 1 (документы 1 и 4) нет слов скворец, ошейник и глаза из других шардов,
+    // но минус-слова из чужих шардов не должны менять результат
+    for (const std::string& query : {"пушистый хвост -скворец"s, "белый кот -ошейник"s, "пушистый пёс -глаза"s, "модный кот -евгений"s, "+кот пушистый"s})
+    {
+        for (const int document_id : server)
+        {
+            const auto [expected_words, expected_status] = server.MatchDocument(query, document_id);
+            const auto [matched_words, status] = sharded_server.MatchDocument(query, document_id);
+            ASSERT_HINT(matched_words == expected_words, query);
+            ASSERT_HINT(status == expected_status, query);
+        }
+    }
+    ASSERT_EQUAL(std::get<0>(sharded_server.MatchDocument("пушистый хвост -скворец"s, 1)).size(), 2u);
+
+    sharded_server.RemoveDocument(6);
+    server.RemoveDocument(6);
+    ASSERT_EQUAL(sharded_server.FindTopDocuments("кот"s).size(), server.FindTopDocuments("кот"s).size());
+    const auto expected_bm25 = server.FindTopDocuments<Bm25Scoring>("кот пушистый"s);
+    const auto found_bm25 = sharded_server.FindTopDocuments<Bm25Scoring>("кот пушистый"s);
+    ASSERT_EQUAL(found_bm25.size(), expected_bm25.size());
+    for (size_t i = 0; i < found_bm25.size(); ++i)
+    {
+        ASSERT_EQUAL(found_bm25[i].id, expected_bm25[i].id);
+        ASSERT(std::abs(found_bm25[i].relevance - expected_bm25[i].relevance) < 1e-6);
+    }
+}
+
+void TestSaveAndLoadIndex()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(0, "белый кот и модный ошейник"s,        DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(1, "пушистый кот пушистый хвост"s,       DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(3, "ухоженный скворец евгений"s,         DocumentStatus::BANNED, {9});
+    server.RemoveDocument(0);
+
+    const std::string path = "test_search_server.idx"s;
+    server.SaveIndex(path);
+
+    SearchServer loaded;
+    loaded.LoadIndex(path);
+
+    // сохранение поверх файла, из которого индекс отображён в память, не портит ни файл, ни индекс
+    loaded.SaveIndex(path);
+    SearchServer reloaded;
+    reloaded.LoadIndex(path);
+    std::remove(path.c_str());
+    ASSERT_EQUAL(reloaded.GetDocumentCount(), server.GetDocumentCount());
+    ASSERT_EQUAL(reloaded.FindTopDocuments("пушистый кот"s).size(), server.FindTopDocuments("пушистый кот"s).size());
+
+    ASSERT_EQUAL(loaded.GetDocumentCount(), server.GetDocumentCount());
+    const auto expected = server.FindTopDocuments("пушистый ухоженный кот -глаза"s);
+    const auto found_docs = loaded.FindTopDocuments("пушистый ухоженный кот -глаза"s);
+    ASSERT_EQUAL(found_docs.size(), expected.size());
+    for (size_t i = 0; i < found_docs.size(); ++i)
+    {
+        ASSERT_EQUAL(found_docs[i].id, expected[i].id);
+        ASSERT_EQUAL(found_docs[i].rating, expected[i].rating);
+    }
+    ASSERT(loaded.FindTopDocuments("скворец"s, DocumentStatus::BANNED).size() == 1);
+
+    // загруженный индекс можно менять: списки копируются из файла при первом изменении
+    loaded.AddDocument(4, "кот скворец"s, DocumentStatus::ACTUAL, {1});
+    loaded.RemoveDocument(1);
+    ASSERT_EQUAL(loaded.FindTopDocuments("кот"s).size(), 1u);
+    ASSERT_EQUAL(loaded.GetWordFrequencies(2).size(), 4u);
+}
+
+void TestLoadIndexRejectsCorruptedFiles()
+{
+    const std::string path = "test_corrupted_index.idx"s;
+    // индекс из одного слова и двух документов в формате SaveIndex
+    const auto write_index = [&path](std::vector<int> document_ids, std::vector<DocumentOrdinal> ordinals)
+    {
+        IndexWriter writer(path);
+        writer.WriteArray(ArrayView<char>(INDEX_FILE_MAGIC, sizeof(INDEX_FILE_MAGIC)));
+        writer.Write(INDEX_FILE_VERSION);
+        writer.Write(uint32_t{0});
+        writer.Write(uint64_t{0});
+        writer.Write(uint64_t{1});
+        writer.WriteString("кот"s);
+
+        const std::vector<TermId> term_ids = {0};
+        const std::vector<double> term_freqs = {1.0};
+        writer.Write(static_cast<uint64_t>(document_ids.size()));
+        for (const int document_id : document_ids)
+        {
+            writer.Write(static_cast<int32_t>(document_id));
+            writer.Write(int32_t{1});
+            writer.Write(static_cast<int32_t>(DocumentStatus::ACTUAL));
+            writer.Write(uint32_t{1});
+            writer.Write(uint32_t{1});
+            writer.Align(sizeof(TermId));
+            writer.WriteArray(ArrayView<TermId>(term_ids));
+            writer.Align(sizeof(double));
+            writer.WriteArray(ArrayView<double>(term_freqs));
+        }
+
+        const std::vector<double> postings_freqs(ordinals.size(), 1.0);
+        writer.Align(sizeof(uint64_t));
+        writer.Write(static_cast<uint64_t>(ordinals.size()));
+        writer.WriteArray(ArrayView<DocumentOrdinal>(ordinals));
+        writer.Align(sizeof(double));
+        writer.WriteArray(ArrayView<double>(postings_freqs));
+        writer.Finish();
+    };
+    const auto is_rejected = [&path]()
+    {
+        SearchServer server;
+        try
+        {
+            server.LoadIndex(path);
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    };
+
+    write_index({1, 2}, {0, 1});
+    ASSERT(!is_rejected());
+    {
+        SearchServer server;
+        server.LoadIndex(path);
+        ASSERT_EQUAL(server.FindTopDocuments("кот"s).size(), 2u);
+    }
+
+    write_index({1, 1}, {0, 1});
+    ASSERT(is_rejected());
+    write_index({1, 2}, {1, 0});
+    ASSERT(is_rejected());
+    write_index({1, 2}, {0, 0});
+    ASSERT(is_rejected());
+    write_index({1, 2}, {0, 2});
+    ASSERT(is_rejected());
+    std::remove(path.c_str());
+}
+
+void TestBatchQueryExecutorKeepsQueryOrder()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(4, "ухоженный скворец евгений"s, DocumentStatus::BANNED, {9});
+
+    const std::vector<std::string> queries = {"пушистый кот"s, "скворец"s, "ухоженный -пёс"s, "кот -ошейник"s, "глаза"s};
+    const auto check = [&server](const std::vector<std::string>& queries, const std::vector<std::vector<Document>>& results)
+    {
+        ASSERT_EQUAL(results.size(), queries.size());
+        for (size_t i = 0; i < queries.size(); ++i)
+        {
+            const auto expected = server.FindTopDocuments(queries[i]);
+            ASSERT_EQUAL_HINT(results[i].size(), expected.size(), queries[i]);
+            for (size_t j = 0; j < expected.size(); ++j)
+            {
+                ASSERT_EQUAL_HINT(results[i][j].id, expected[j].id, queries[i]);
+            }
+        }
+    };
+
+    BatchQueryExecutor executor(server, 2);
+    // второй пакет идёт через те же буферы потоков
+    for (int batch = 0; batch < 2; ++batch)
+    {
+        check(queries, executor.ProcessQueries(queries));
+    }
+
+    // пакеты из двух потоков сразу выполняются по очереди; пакеты большие, чтобы вызовы пересеклись
+    std::vector<std::string> long_batch;
+    for (int i = 0; i < 200; ++i)
+    {
+        long_batch.insert(long_batch.end(), queries.begin(), queries.end());
+    }
+    std::vector<std::vector<Document>> other_results;
+    std::thread other([&executor, &long_batch, &other_results]()
+    {
+        other_results = executor.ProcessQueries(long_batch);
+    });
+    const auto results = executor.ProcessQueries(long_batch);
+    other.join();
+    check(long_batch, results);
+    check(long_batch, other_results);
+}
+
+void TestProcessQueriesJoinedKeepsQueryOrder()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+    server.AddDocument(2, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(3, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    server.AddDocument(4, "ухоженный скворец евгений"s, DocumentStatus::ACTUAL, {9});
+
+    // запросы без результатов стоят в начале, в середине и в конце, в том числе целой порцией
+    const std::vector<std::string> queries = {"попугай"s, "пушистый кот"s, "попугай"s, "попугай"s, "ухоженный -пёс"s,
+                                              "кот -ошейник"s, "скворец глаза кот"s, "попугай"s};
+    // документы подряд, как их раньше собирал std::list
+    std::vector<Document> expected;
+    for (const auto& documents : ProcessQueries(server, queries))
+    {
+        expected.insert(expected.end(), documents.begin(), documents.end());
+    }
+    ASSERT(!expected.empty());
+
+    const auto check = [&expected](const std::vector<Document>& found_docs, const std::string& hint)
+    {
+        ASSERT_EQUAL_HINT(found_docs.size(), expected.size(), hint);
+        for (size_t i = 0; i < found_docs.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_docs[i].id, expected[i].id, hint);
+            ASSERT_EQUAL_HINT(found_docs[i].relevance, expected[i].relevance, hint);
+            ASSERT_EQUAL_HINT(found_docs[i].rating, expected[i].rating, hint);
+        }
+    };
+
+    for (const size_t batch_size : {1, 2, 3, 100})
+    {
+        std::vector<Document> found_docs;
+        for (const Document& document : JoinedDocuments(server, queries, batch_size))
+        {
+            found_docs.push_back(document);
+        }
+        check(found_docs, "batch size "s + std::to_string(batch_size));
+    }
+
+    std::vector<Document> found_docs;
+    for (const Document& document : ProcessQueriesJoined(server, queries))
+    {
+        found_docs.push_back(document);
+    }
+    check(found_docs, "range"s);
+
+    found_docs.clear();
+    ProcessQueriesJoined(server, queries, [&found_docs](const Document& document)
+    {
+        found_docs.push_back(document);
+    });
+    check(found_docs, "sink"s);
+
+    // диапазон однопроходный: после полного чтения он пуст
+    JoinedDocuments documents = ProcessQueriesJoined(server, queries);
+    ASSERT(documents.begin() != documents.end());
+    size_t count = 0;
+    for (auto it = documents.begin(); it != documents.end(); ++it)
+    {
+        ++count;
+    }
+    ASSERT_EQUAL(count, expected.size());
+    ASSERT(documents.begin() == documents.end());
+}
+
+void TestAddDocumentsMatchesSequentialAdd()
+{
+    const std::vector<std::string> texts = {
+        "белый кот и модный ошейник"s,
+        "пушистый кот пушистый хвост"s,
+        "ухоженный пёс выразительные глаза"s,
+        "ухоженный скворец евгений"s,
+    };
+    std::vector<NewDocument> documents;
+    SearchServer server("и в на"s);
+    for (size_t i = 0; i < texts.size(); ++i)
+    {
+        const int id = static_cast<int>(i) * 10;
+        documents.push_back({id, texts[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 3}});
+        server.AddDocument(id, texts[i], DocumentStatus::ACTUAL, {static_cast<int>(i), 3});
+    }
+
+    SearchServer bulk_server("и в на"s);
+    bulk_server.AddDocuments(std::execution::par, documents);
+    ASSERT_EQUAL(bulk_server.GetDocumentCount(), server.GetDocumentCount());
+    for (const NewDocument& document : documents)
+    {
+        ASSERT(bulk_server.GetWordFrequencies(document.id) == server.GetWordFrequencies(document.id));
+    }
+    for (const std::string& query : {"пушистый ухоженный кот"s, "модный -ошейник"s, "скворец"s})
+    {
+        const auto expected = server.FindTopDocuments(query);
+        const auto found_docs = bulk_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(found_docs.size(), expected.size(), query);
+        for (size_t i = 0; i < found_docs.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_docs[i].id, expected[i].id, query);
+            ASSERT_EQUAL_HINT(found_docs[i].relevance, expected[i].relevance, query);
+        }
+    }
+
+    // повторный id - пакет отклоняется целиком
+    try
+    {
+        bulk_server.AddDocuments(std::vector<NewDocument>{{100, "новый документ", DocumentStatus::ACTUAL, {}}, {0, "дубликат", DocumentStatus::ACTUAL, {}}});
+        ASSERT_HINT(false, "duplicate id must be rejected"s);
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+    ASSERT_EQUAL(bulk_server.GetDocumentCount(), server.GetDocumentCount());
+}
+
+void TestSegmentedSearchMatchesSingleServer()
+{
+    const std::vector<std::string> documents = {
+        "белый кот и модный ошейник"s,
+        "пушистый кот пушистый хвост"s,
+        "ухоженный пёс выразительные глаза"s,
+        "ухоженный скворец евгений"s,
+        "пушистый пёс и белый хвост"s,
+        "модный скворец"s,
+        "кот кот кот"s,
+    };
+
+    SearchServer server("и в на"s);
+    // по два документа в сегменте, чтобы запечатывание и слияние сработали
+    SegmentedSearchServer segmented_server("и в на"s, 2, 2);
+    server.SetPositionalIndex(true);
+    segmented_server.SetPositionalIndex(true);
+    for (size_t i = 0; i < documents.size(); ++i)
+    {
+        server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i)});
+        segmented_server.AddDocument(static_cast<int>(i), documents[i], DocumentStatus::ACTUAL, {static_cast<int>(i)});
+    }
+    server.RemoveDocument(1);
+    segmented_server.RemoveDocument(1);
+    segmented_server.WaitForMerges();
+    // удалённый после слияния документ остаётся в запечатанном сегменте и не должен влиять на среднюю длину для BM25
+    server.RemoveDocument(3);
+    segmented_server.RemoveDocument(3);
+    // удаление могло запустить ещё одно слияние
+    segmented_server.WaitForMerges();
+    ASSERT_EQUAL(segmented_server.GetDocumentCount(), server.GetDocumentCount());
+
+    for (const std::string& query : {"пушистый ухоженный кот"s, "модный -ошейник"s, "белый пёс хвост"s, "кот"s, "+кот белый"s, "\"пушистый хвост\" скворец"s})
+    {
+        const auto expected = server.FindTopDocuments(query);
+        const auto found_docs = segmented_server.FindTopDocuments(query);
+        ASSERT_EQUAL_HINT(found_docs.size(), expected.size(), query);
+        for (size_t i = 0; i < found_docs.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_docs[i].id, expected[i].id, query);
+            ASSERT_HINT(std::abs(found_docs[i].relevance - expected[i].relevance) < 1e-6, query);
+        }
+
+        const auto expected_bm25 = server.FindTopDocuments<Bm25Scoring>(query);
+        const auto found_bm25 = segmented_server.FindTopDocuments<Bm25Scoring>(query);
+        ASSERT_EQUAL_HINT(found_bm25.size(), expected_bm25.size(), query);
+        for (size_t i = 0; i < found_bm25.size(); ++i)
+        {
+            ASSERT_EQUAL_HINT(found_bm25[i].id, expected_bm25[i].id, query);
+            ASSERT_HINT(std::abs(found_bm25[i].relevance - expected_bm25[i].relevance) < 1e-6, query);
+        }
+    }
+
+    // найденные слова возвращаются без синтаксиса запроса: без плюса и кавычек. Минус-слова из других сегментов
+    // (скворец, евгений, глаза) не должны менять результат, каким бы ни было разбиение на сегменты
+    for (const std::string& query : {"+кот белый -пёс"s, "\"белый кот\" -скворец"s, "+модный \"кот и\" -пёс"s,
+                                     "белый кот -евгений"s, "модный пушистый хвост -глаза"s, "кот скворец"s})
+    {
+        for (const int document_id : server)
+        {
+            const auto [expected_words, expected_status] = server.MatchDocument(query, document_id);
+            const auto [matched_words, status] = segmented_server.MatchDocument(query, document_id);
+            ASSERT_EQUAL_HINT(matched_words.size(), expected_words.size(), query);
+            ASSERT_HINT(document_id != 0 || !matched_words.empty(), query);
+            for (size_t i = 0; i < matched_words.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(matched_words[i], expected_words[i], query);
+            }
+        }
+    }
+}
+
+void TestVersionedSearchKeepsPinnedSnapshot()
+{
+    VersionedSearchServer server("и в на"s, 0);
+    server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    ASSERT(server.FindTopDocuments("кот"s).empty());
+    server.Publish();
+
+    {
+        const auto snapshot = server.GetSnapshot();
+        server.AddDocument(2, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {8, -3});
+        server.RemoveDocument(1);
+        server.Publish();
+
+        // закреплённая версия не видит изменений, новые запросы видят
+        ASSERT_EQUAL(snapshot->FindTopDocuments("кот"s).size(), 1u);
+        ASSERT_EQUAL(snapshot->FindTopDocuments("кот"s)[0].id, 1);
+        const auto found_docs = server.FindTopDocuments("кот"s);
+        ASSERT_EQUAL(found_docs.size(), 1u);
+        ASSERT_EQUAL(found_docs[0].id, 2);
+        ASSERT_EQUAL(server.GetGeneration(), 2u);
+    }
+
+    // старая версия отпущена и догоняет новую по журналу
+    server.AddDocument(3, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5});
+    server.Publish();
+    ASSERT_EQUAL(server.GetDocumentCount(), 2u);
+    ASSERT_EQUAL(server.FindTopDocuments("кот пёс"s).size(), 2u);
+}
+
+void TestVersionedSearchConcurrentReadersAndWriter()
+{
+    // маленький интервал публикации: писатель постоянно переиспользует версии, которые только что отпустили читатели
+    VersionedSearchServer server("и в на"s, 2);
+    std::atomic<bool> is_writing = true;
+
+    const auto read = [&server, &is_writing]()
+    {
+        const auto all_documents = []([[__maybe_unused__]]int document_id, [[__maybe_unused__]]DocumentStatus status, [[__maybe_unused__]]int rating)
+        {
+            return true;
+        };
+        while (is_writing.load())
+        {
+            // в каждом документе есть слово "кот", поэтому в закреплённой версии находятся все её документы
+            const auto snapshot = server.GetSnapshot();
+            const size_t document_count = snapshot->GetDocumentCount();
+            ASSERT_EQUAL(snapshot->FindTopDocuments("кот"s, all_documents, document_count + 1).size(), document_count);
+            server.FindTopDocuments("пушистый кот -пёс"s);
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 2; ++i)
+    {
+        readers.emplace_back(read);
+    }
+
+    for (int document_id = 0; document_id < 3000; ++document_id)
+    {
+        server.AddDocument(document_id, "кот пушистый "s + std::to_string(document_id % 17) + (document_id % 5 == 0 ? " пёс"s : ""s), DocumentStatus::ACTUAL, {document_id % 7});
+        if (document_id % 3 == 2)
+        {
+            server.RemoveDocument(document_id - 2);
+        }
+    }
+    server.Publish();
+    is_writing = false;
+    for (std::thread& reader : readers)
+    {
+        reader.join();
+    }
+
+    ASSERT_EQUAL(server.GetDocumentCount(), 2000u);
+    ASSERT_EQUAL(server.GetSnapshot()->FindTopDocuments("кот"s, DocumentStatus::ACTUAL, 3000).size(), 2000u);
+}
+
+void TestRemoveDuplicatesKeepsSmallestId()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(5, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "хвост и пушистый кот"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "кот хвост пёс"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "в на"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(1, "и"s, DocumentStatus::ACTUAL, {1});
+
+    // совпадают наборы слов, а не тексты: стоп-слова и повторы не учитываются
+    ASSERT(server.FindDuplicates(std::execution::par) == std::vector<int>({4, 5}));
+    RemoveDuplicates(std::execution::par, server);
+    ASSERT_EQUAL(server.GetDocumentCount(), 3u);
+    ASSERT_EQUAL(server.FindTopDocuments("пушистый кот"s).size(), 2u);
+    ASSERT(server.FindDuplicates().empty());
+}
+
+void TestNearDuplicatesFormClusters()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(7, "пушистый кот пушистый хвост модный ошейник"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "пушистый кот и хвост модный ошейник"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(9, "пушистый кот хвост модный ошейник белый"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(5, "ухоженный скворец евгений"s, DocumentStatus::ACTUAL, {1});
+
+    // 9 отличается от 3 и 7 одним словом из шести: мера Жаккара 5/6
+    const auto clusters = server.FindNearDuplicates(std::execution::par, {0.8, 16, 4});
+    ASSERT(clusters == std::vector<std::vector<int>>({{3, 7, 9}}));
+    ASSERT(server.FindNearDuplicates({0.9, 16, 4}) == std::vector<std::vector<int>>({{3, 7}}));
+
+    RemoveNearDuplicates(server, {0.8, 16, 4});
+    ASSERT_EQUAL(server.GetDocumentCount(), 3u);
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s).size(), 1u);
+    ASSERT_EQUAL(server.FindTopDocuments("кот"s)[0].id, 3);
+}
+
+void TestQueryResultCacheInvalidatesOnChange()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "ухоженный пёс выразительные глаза"s, DocumentStatus::ACTUAL, {5});
+    QueryResultCache cache(server, 8);
+
+    // порядок, повторы и стоп-слова не важны: запросы совпадают после разбора
+    ASSERT_EQUAL(cache.FindTopDocuments("кот пёс"s).size(), 2u);
+    ASSERT_EQUAL(cache.FindTopDocuments("пёс и кот кот"s).size(), 2u);
+    ASSERT_EQUAL(cache.GetHitCount(), 1u);
+    ASSERT_EQUAL(cache.GetMissCount(), 1u);
+    ASSERT(cache.FindTopDocuments("кот"s, DocumentStatus::BANNED).empty());
+    ASSERT_EQUAL(cache.GetMissCount(), 2u);
+
+    server.RemoveDocument(1);
+    const auto found_docs = cache.FindTopDocuments("кот пёс"s);
+    ASSERT_EQUAL(found_docs.size(), 1u);
+    ASSERT_EQUAL(found_docs[0].id, 2);
+    ASSERT_EQUAL(cache.GetMissCount(), 3u);
+}
+
+void TestWandMatchesExhaustiveSearch()
+{
+    SearchServer server("и в на"s);
+    const std::vector<std::string> words = {"кот"s, "пёс"s, "хвост"s, "ошейник"s, "глаза"s, "скворец"s, "пушистый"s, "модный"s};
+    for (int id = 0; id < 1000; ++id)
+    {
+        // частые слова есть почти везде, редкие - в немногих документах
+        std::string text;
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            if ((id * 7 + i * 13) % (i + 2) == 0 || (id % 97 == static_cast<int>(i)))
+            {
+                text += words[i] + " "s;
+            }
+        }
+        server.AddDocument(id, text + "слово"s + std::to_string(id % 50), static_cast<DocumentStatus>(id % 3), {id % 5});
+    }
+    for (int id = 0; id < 1000; id += 9)
+    {
+        server.RemoveDocument(id);
+    }
+
+    // последний запрос длиннее WAND_MAX_QUERY_TERMS и считается полным перебором
+    SearchServer::QueryScratch scratch;
+    for (const std::string& query : {"кот пёс"s, "кот скворец модный"s, "пушистый -глаза хвост"s, "слово7 кот"s,
+                                     "кот пёс хвост ошейник глаза слово3"s, "кот пёс хвост ошейник глаза скворец пушистый модный"s})
+    {
+        for (const size_t max_count : {1u, 5u, 40u})
+        {
+            server.SetQueryEvaluation(QueryEvaluation::EXHAUSTIVE);
+            const auto expected = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, max_count);
+            server.SetQueryEvaluation(QueryEvaluation::WAND);
+            const auto found_docs = server.FindTopDocuments(query, DocumentStatus::IRRELEVANT, max_count);
+            const auto scratch_docs = server.FindTopDocuments(scratch, query, DocumentStatus::IRRELEVANT, max_count);
+
+            ASSERT_EQUAL_HINT(found_docs.size(), expected.size(), query);
+            ASSERT_EQUAL_HINT(scratch_docs.size(), expected.size(), query);
+            for (size_t i = 0; i < found_docs.size(); ++i)
+            {
+                ASSERT_EQUAL_HINT(found_docs[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(found_docs[i].relevance, expected[i].relevance, query);
+                ASSERT_EQUAL_HINT(scratch_docs[i].id, expected[i].id, query);
+                ASSERT_EQUAL_HINT(scratch_docs[i].relevance, expected[i].relevance, query);
+            }
+        }
+    }
+}
+
+void TestWordFrequenciesShareDictionaryWords()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "пушистый кот пушистый хвост"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "кот"s, DocumentStatus::ACTUAL, {3});
+
+    const auto word_freqs = server.GetWordFrequencies(2);
+    ASSERT_EQUAL(word_freqs.size(), 3u);
+    ASSERT_EQUAL(word_freqs.at("пушистый"), 0.5);
+    ASSERT_EQUAL(word_freqs.at("хвост"), 0.25);
+
+    // строка слова одна на сервер, удаление других документов её не трогает
+    const std::string_view cat = server.GetWordFrequencies(1).find("кот")->first;
+    ASSERT(cat.data() == word_freqs.find("кот")->first.data());
+    server.RemoveDocument(1);
+    server.RemoveDocument(3);
+    ASSERT_EQUAL(server.GetWordFrequencies(2).find("кот")->first, cat);
+    ASSERT(server.GetWordFrequencies(1).empty());
+}
+
+void TestScratchSearchDoesNotAllocate()
+{
+
+    SearchServer server("и в на"s);
+    for (int id = 0; id < 500; ++id)
+    {
+        server.AddDocument(id, "кот"s + std::to_string(id % 7) + " пёс"s + std::to_string(id % 11) + " хвост ошейник"s, DocumentStatus::ACTUAL, {id % 5});
+    }
+    server.RemoveDocument(3);
+
+    const std::vector<std::string> queries = {"кот1 пёс2"s, "хвост -кот3"s, "ошейник кот5 пёс5 пёс7"s, "скворец"s};
+    for (const QueryEvaluation evaluation : {QueryEvaluation::EXHAUSTIVE, QueryEvaluation::WAND})
+    {
+        server.SetQueryEvaluation(evaluation);
+        SearchServer::QueryScratch scratch;
+        // первые запросы наращивают буферы до нужного размера
+        for (const std::string& query : queries)
+        {
+            server.FindTopDocuments(scratch, query);
+        }
+
+        const AllocationCounter allocations;
+        size_t found_count = 0;
+        for (int i = 0; i < 10; ++i)
+        {
+            for (const std::string& query : queries)
+            {
+                found_count += server.FindTopDocuments(scratch, query).size();
+            }
+        }
+        // ASSERT_EQUAL сам создаёт строки, поэтому счётчик читается до него
+        const uint64_t allocation_count = allocations.GetCount();
+        // без SEARCH_SERVER_COUNT_ALLOCATIONS выделения не считаются и проверяются только результаты
+        if (AllocationCounter::IsEnabled())
+        {
+            ASSERT_EQUAL(allocation_count, 0u);
+        }
+        ASSERT(found_count > 0);
+    }
+}
+
+void TestPhraseQueriesNeedAdjacentWords()
+{
+    SearchServer server("и в на"s);
+    server.SetPositionalIndex(true);
+    server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "кот белый пушистый"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "белый пёс и кот"s, DocumentStatus::ACTUAL, {3});
+    server.AddDocument(4, "пушистый белый кот"s, DocumentStatus::ACTUAL, {4});
+
+    const auto found_docs = server.FindTopDocuments("\"белый кот\""s);
+    ASSERT_EQUAL(found_docs.size(), 2u);
+    ASSERT_EQUAL(found_docs[0].id, 4);
+    ASSERT_EQUAL(found_docs[1].id, 1);
+    ASSERT_EQUAL(server.FindTopDocuments("\"белый кот\" -ошейник"s).size(), 1u);
+    // стоп-слова внутри фразы пропускаются, как и при индексации
+    ASSERT_EQUAL(server.FindTopDocuments("\"пёс и кот\""s).size(), 1u);
+    ASSERT(std::get<0>(server.MatchDocument(std::execution::par, "\"белый кот\""s, 2)).empty());
+
+    // при равных TF x IDF выше документ, где слова запроса ближе друг к другу
+    server.AddDocument(5, "скворец модный пушистый хвост"s, DocumentStatus::BANNED, {5});
+    server.AddDocument(6, "скворец хвост модный пушистый"s, DocumentStatus::BANNED, {5});
+    const auto near_docs = server.FindTopDocuments("\"скворец\" хвост"s, DocumentStatus::BANNED);
+    ASSERT_EQUAL(near_docs.size(), 2u);
+    ASSERT_EQUAL(near_docs[0].id, 6);
+    ASSERT(near_docs[0].relevance > near_docs[1].relevance);
+
+    SearchServer no_positions("и в на"s);
+    no_positions.AddDocument(1, "белый кот"s, DocumentStatus::ACTUAL, {1});
+    try
+    {
+        no_positions.FindTopDocuments("\"белый кот\""s);
+        ASSERT_HINT(false, "phrase query without positional index must throw"s);
+    }
+    catch (const std::invalid_argument&)
+    {
+    }
+}
+
+void TestRequiredWordsAndQueryOperator()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "белый кот и модный ошейник"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "чёрный кот"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "белый пёс и пушистый хвост"s, DocumentStatus::ACTUAL, {3});
+
+    ASSERT_EQUAL(server.FindTopDocuments("белый кот"s).size(), 3u);
+    const auto required_docs = server.FindTopDocuments("+белый кот"s);
+    ASSERT_EQUAL(required_docs.size(), 2u);
+    ASSERT_EQUAL(required_docs[0].id, 1);
+    ASSERT_EQUAL(required_docs[1].id, 3);
+    // обязательное слово, которого нет в индексе, ничего не находит
+    ASSERT(server.FindTopDocuments("+рыжий кот"s).empty());
+    ASSERT(server.FindTopDocuments("+и кот"s).size() == 2u);
+    ASSERT(std::get<0>(server.MatchDocument("+белый кот"s, 2)).empty());
+
+    server.SetQueryOperator(QueryOperator::AND);
+    const auto and_docs = server.FindTopDocuments("белый кот"s);
+    ASSERT_EQUAL(and_docs.size(), 1u);
+    ASSERT_EQUAL(and_docs[0].id, 1);
+    ASSERT(server.FindTopDocuments("белый рыжий"s).empty());
+    ASSERT(std::get<0>(server.MatchDocument(std::execution::par, "белый кот"s, 3)).empty());
+    server.SetQueryOperator(QueryOperator::OR);
+
+    for (const std::string& query : { "+"s, "+-кот"s, "++кот"s })
+    {
+        try
+        {
+            server.FindTopDocuments(query);
+            ASSERT_HINT(false, "invalid required word must throw"s);
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+    }
+}
+
+// Сколько слов запроса есть в документе - для проверки своей политики подсчёта
+class MatchedWordCountScoring
+{
+public:
+    explicit MatchedWordCountScoring([[__maybe_unused__]]const ScoringStatistics& statistics){}
+
+    double ComputeInverseDocumentFreq([[__maybe_unused__]]size_t document_freq, [[__maybe_unused__]]double log_document_freq) const
+    {
+        return 1.0;
+    }
+    double Score([[__maybe_unused__]]double term_freq, [[__maybe_unused__]]double length_norm, double inverse_document_freq) const
+    {
+        return inverse_document_freq;
+    }
+    double GetMaxScore([[__maybe_unused__]]double max_term_freq, double inverse_document_freq) const
+    {
+        return inverse_document_freq;
+    }
+};
+
+void TestScoringPolicies()
+{
+    SearchServer server("и в на"s);
+    server.AddDocument(1, "кот пёс"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "кот кот кот кот пёс пёс пёс пёс хвост хвост"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "белый пушистый хвост"s, DocumentStatus::ACTUAL, {1});
+
+    // TF-IDF делит число вхождений на длину документа, BM25 штрафует длину слабее
+    const auto tf_idf_docs = server.FindTopDocuments("кот"s);
+    ASSERT_EQUAL(tf_idf_docs.size(), 2u);
+    ASSERT_EQUAL(tf_idf_docs[0].id, 1);
+
+    const double average_length = (2.0 + 10.0 + 3.0) / 3.0;
+    const double inverse_document_freq = std::log(1.0 + (3.0 - 2.0 + 0.5) / (2.0 + 0.5));
+    const double expected_relevance = inverse_document_freq * 4.0 * 2.2 / (4.0 + 1.2 * (0.25 + 0.75 * 10.0 / average_length));
+    for (const QueryEvaluation evaluation : { QueryEvaluation::EXHAUSTIVE, QueryEvaluation::WAND })
+    {
+        server.SetQueryEvaluation(evaluation);
+        const auto bm25_docs = server.FindTopDocuments<Bm25Scoring>("кот"s);
+        ASSERT_EQUAL(bm25_docs.size(), 2u);
+        ASSERT_EQUAL(bm25_docs[0].id, 2);
+        ASSERT(std::abs(bm25_docs[0].relevance - expected_relevance) < EPSILON);
+
+        const auto count_docs = server.FindTopDocuments<MatchedWordCountScoring>("кот хвост"s);
+        ASSERT_EQUAL(count_docs.size(), 3u);
+        ASSERT_EQUAL(count_docs[0].id, 2);
+        ASSERT(std::abs(count_docs[0].relevance - 2.0) < EPSILON);
+    }
+    ASSERT_EQUAL(server.FindTopDocuments<Bm25Scoring>(std::execution::par, "+кот +хвост"s).size(), 1u);
+
+    // длины документов восстанавливаются и из файла индекса
+    const std::string path = "test_scoring_policies.idx"s;
+    server.SaveIndex(path);
+    SearchServer loaded;
+    loaded.LoadIndex(path);
+    std::remove(path.c_str());
+    ASSERT(std::abs(loaded.FindTopDocuments<Bm25Scoring>("кот"s)[0].relevance - expected_relevance) < EPSILON);
+}
+
+void TestSplitIntoWordsMatchesScalarSplit()
+{
+    // посимвольное разбиение, с которым сверяется блочный (SIMD) разбор
+    const auto split_scalar = [](std::string_view text, std::vector<std::string_view>& words)
+    {
+        words.clear();
+        bool has_control_chars = false;
+        size_t word_begin = 0;
+        for (size_t pos = 0; pos <= text.size(); ++pos)
+        {
+            if (pos == text.size() || text[pos] == ' ')
+            {
+                if (pos != word_begin)
+                {
+                    words.push_back(text.substr(word_begin, pos - word_begin));
+                }
+                word_begin = pos + 1;
+            }
+            else if (text[pos] >= '\0' && text[pos] < ' ')
+            {
+                has_control_chars = true;
+            }
+        }
+        return !has_control_chars;
+    };
+
+    std::vector<std::string_view> words;
+    std::vector<std::string_view> expected_words;
+    const auto check = [&](const std::string& text)
+    {
+        const bool is_valid = SplitIntoWords(text, words);
+        const bool expected_valid = split_scalar(text, expected_words);
+        ASSERT_EQUAL_HINT(is_valid, expected_valid, text);
+        ASSERT_EQUAL_HINT(words.size(), expected_words.size(), text);
+        for (size_t i = 0; i < words.size(); ++i)
+        {
+            ASSERT_HINT(words[i] == expected_words[i], text);
+            // слова - части исходной строки, а не копии
+            ASSERT_HINT(words[i].data() >= text.data() && words[i].data() + words[i].size() <= text.data() + text.size(), text);
+        }
+        ASSERT_HINT(SplitIntoWords(std::string_view(text)) == expected_words, text);
+    };
+
+    check(""s);
+    check(" "s);
+    check("кот"s);
+
+    // длины вокруг границ блоков в 16 и 32 байта; пробел, серия пробелов или управляющий символ
+    // в каждой позиции, в том числе первой и последней в блоке
+    for (const size_t length : {15u, 16u, 17u, 31u, 32u, 33u, 47u, 48u, 63u, 64u, 65u})
+    {
+        check(std::string(length, 'a'));
+        check(std::string(length, ' '));
+        for (size_t pos = 0; pos < length; ++pos)
+        {
+            std::string text(length, 'a');
+            text[pos] = ' ';
+            check(text);
+            text.replace(pos, std::min<size_t>(3, length - pos), std::min<size_t>(3, length - pos), ' ');
+            check(text);
+            text[pos] = '\t';
+            check(text);
+            text[pos] = '\n';
+            check(text);
+        }
+    }
+
+    // многобайтовые символы UTF-8 (байты больше 127) не считаются ни пробелами, ни управляющими
+    const std::vector<std::string> pieces = {"кот"s, " "s, "   "s, "ёжик"s, "a"s, "пушистый"s, "\xF0\x9F\x90\x88"s, "  хвост "s};
+    for (size_t offset = 0; offset < 40; ++offset)
+    {
+        std::string text(offset % 7, ' ');
+        for (size_t i = 0; text.size() < 100; ++i)
+        {
+            text += pieces[(i * 5 + offset) % pieces.size()];
+            check(text);
+        }
+    }
+}
+
+void TestFilterStopWordsMatchesIsStopWord()
+{
+    // слова - части одной строки, поэтому поиск в стоп-словах идёт по string_view без копий
+    const std::string text = "и кот в  на ил и инжир на на кот в\xC3\xA9 в v и и"s;
+    const std::vector<std::string_view> words = SplitIntoWords(text);
+
+    const SearchServer empty_server;
+    const SearchServer server("и в на"s);
+    const SearchServer latin_server(std::vector<std::string>{"v"s, "кот"s});
+    for (const SearchServer* search_server : {&empty_server, &server, &latin_server})
+    {
+        std::vector<std::string_view> expected;
+        std::copy_if(words.begin(), words.end(), std::back_inserter(expected), [search_server](std::string_view word)
+        {
+            return !search_server->IsStopWord(word);
+        });
+
+        std::vector<std::string_view> filtered = words;
+        search_server->FilterStopWords(filtered);
+        ASSERT(filtered == expected);
+
+        std::vector<std::string_view> empty_words;
+        search_server->FilterStopWords(empty_words);
+        ASSERT(empty_words.empty());
+    }
+
+    std::vector<std::string_view> filtered = words;
+    empty_server.FilterStopWords(filtered);
+    ASSERT(filtered == words);
+
+    filtered = words;
+    server.FilterStopWords(filtered);
+    ASSERT_EQUAL(filtered.size(), 6u);
+    ASSERT(!server.IsStopWord("ил"s) && !server.IsStopWord(""s) && server.IsStopWord("на"s));
+}
@@ -4,11 +4,20 @@
 #include "document.h"
 #include "remove_duplicates.h"
 #include "search_server.h"
+#include "sharded_search_server.h"
+#include "process_queries.h"
+#include "segmented_search_server.h"
+#include "versioned_search_server.h"
+#include "query_result_cache.h"
+#include "allocation_counter.h"
 
 #include <vector>
 #include <string>
 #include <iostream>
 #include <tuple>
+#include <thread>
+#include <atomic>
+#include <cstdio>
 
 using std::string_literals::operator""s;
 
@@ -0,0 +1,61 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(size_t thread_count)
+{
+    if (thread_count == 0)
+    {
+        thread_count = 1;
+    }
+
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        workers_.emplace_back([this]()
+        {
+            Work();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_);
+        is_stopped_ = true;
+    }
+    has_task_.notify_all();
+
+    for (std::thread& worker : workers_)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Work()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_);
+            has_task_.wait(lock, [this]()
+            {
+                return is_stopped_ || !tasks_.empty();
+            });
+
+            // перед остановкой дорабатываем уже поставленные задачи
+            if (tasks_.empty())
+            {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return workers_.size();
+}
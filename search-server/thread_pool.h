@@ -0,0 +1,56 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Постоянный пул потоков: задачи выполняются в порядке поступления, результат - через std::future.
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex m_;
+    std::condition_variable has_task_;
+    bool is_stopped_ = false;
+
+    void Work();
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    explicit ThreadPool(size_t thread_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //------------------METHODS-----------------//
+    template <typename Function>
+    std::future<std::invoke_result_t<Function>> Submit(Function function);
+
+    //------------------GETS-----------------//
+    size_t GetThreadCount() const;
+};
+
+template <typename Function>
+std::future<std::invoke_result_t<Function>> ThreadPool::Submit(Function function)
+{
+    // std::function требует копируемости, а packaged_task только перемещается
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Function>()>>(std::move(function));
+    auto result = task->get_future();
+    {
+        std::lock_guard<std::mutex> guard(m_);
+        tasks_.push([task]()
+        {
+            (*task)();
+        });
+    }
+    has_task_.notify_one();
+    return result;
+}
@@ -0,0 +1,154 @@
+#include "versioned_search_server.h"
+
+#include <thread>
+
+//------------------constructors-----------------------//
+
+VersionedSearchServer::VersionedSearchServer(const std::string& stop_words, size_t publish_interval)
+    : VersionedSearchServer(SplitIntoWords(stop_words), publish_interval)
+{
+}
+
+VersionedSearchServer::VersionedSearchServer(std::string_view stop_words, size_t publish_interval)
+    : VersionedSearchServer(SplitIntoWords(stop_words), publish_interval)
+{
+}
+
+//--------------------private methods------------------//
+
+// Вызывается под write_m_. Готовит закрытую копию для следующих изменений
+void VersionedSearchServer::PreparePending()
+{
+    if (pending_)
+    {
+        return;
+    }
+
+    // запросы короткие: немного ждём, пока читатели отпустят старую версию, прежде чем копировать индекс
+    const auto wait_deadline = std::chrono::steady_clock::now() + RETIRED_VERSION_WAIT;
+    while (retired_ && !retired_released_->load(std::memory_order_acquire) && std::chrono::steady_clock::now() < wait_deadline)
+    {
+        std::this_thread::yield();
+    }
+
+    // читатели старую версию отпустили, их чтения завершились до acquire выше - догоняем её журналом вместо полной копии.
+    // use_count() для этого не годится: он читается без упорядочивания
+    if (retired_ && retired_released_->load(std::memory_order_acquire))
+    {
+        for (const Operation& operation : replay_log_)
+        {
+            Replay(*retired_, operation);
+        }
+        pending_ = std::move(retired_);
+    }
+    else
+    {
+        pending_ = std::make_shared<SearchServer>(*published_);
+    }
+    retired_.reset();
+    retired_released_.reset();
+    replay_log_.clear();
+}
+
+// Вызывается под write_m_
+void VersionedSearchServer::Apply(Operation operation)
+{
+    PreparePending();
+    // при исключении закрытая копия не меняется и операция не попадает в журнал
+    Replay(*pending_, operation);
+    log_.push_back(std::move(operation));
+
+    if (publish_interval_ != 0 && log_.size() >= publish_interval_)
+    {
+        PublishLocked();
+    }
+}
+
+// Вызывается под write_m_
+void VersionedSearchServer::PublishLocked()
+{
+    if (!pending_)
+    {
+        return;
+    }
+
+    auto released = std::make_shared<std::atomic<bool>>(false);
+    std::atomic_store(&current_, MakeSnapshot(pending_, released));
+    ++generation_;
+
+    retired_ = std::move(published_);
+    retired_released_ = std::move(published_released_);
+    replay_log_ = std::move(log_);
+    log_.clear();
+    published_ = std::move(pending_);
+    published_released_ = std::move(released);
+    pending_.reset();
+}
+
+void VersionedSearchServer::Replay(SearchServer& search_server, const Operation& operation)
+{
+    if (operation.is_removal)
+    {
+        search_server.RemoveDocument(operation.document_id);
+    }
+    else
+    {
+        search_server.AddDocument(operation.document_id, operation.document, operation.status, operation.ratings);
+    }
+}
+
+std::shared_ptr<const SearchServer> VersionedSearchServer::MakeSnapshot(std::shared_ptr<SearchServer> index, std::shared_ptr<std::atomic<bool>> released)
+{
+    SearchServer* const data = index.get();
+    // владение индексом держит и сам снимок, чтобы версия пережила VersionedSearchServer
+    return std::shared_ptr<const SearchServer>(data, [index = std::move(index), released = std::move(released)]([[__maybe_unused__]]const SearchServer* search_server) mutable
+    {
+        index.reset();
+        released->store(true, std::memory_order_release);
+    });
+}
+
+//--------------------public methods------------------//
+
+void VersionedSearchServer::AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings)
+{
+    std::lock_guard<std::mutex> guard(write_m_);
+    Apply({ false, document_id, std::string(document), status, ratings });
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id)
+{
+    std::lock_guard<std::mutex> guard(write_m_);
+    Apply({ true, document_id, {}, DocumentStatus::ACTUAL, {} });
+}
+
+void VersionedSearchServer::Publish()
+{
+    std::lock_guard<std::mutex> guard(write_m_);
+    PublishLocked();
+}
+
+std::vector<Document> VersionedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query, status, max_count);
+}
+
+std::vector<Document> VersionedSearchServer::FindTopDocuments(const std::string_view& raw_query) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query);
+}
+
+std::shared_ptr<const SearchServer> VersionedSearchServer::GetSnapshot() const
+{
+    return std::atomic_load(&current_);
+}
+
+uint64_t VersionedSearchServer::GetGeneration() const
+{
+    return generation_;
+}
+
+size_t VersionedSearchServer::GetDocumentCount() const
+{
+    return GetSnapshot()->GetDocumentCount();
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "search_server.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+const size_t DEFAULT_PUBLISH_INTERVAL = 64;
+// Сколько писатель ждёт освобождения старой версии, прежде чем скопировать индекс целиком
+const std::chrono::milliseconds RETIRED_VERSION_WAIT{1};
+
+// SearchServer с неизменяемыми опубликованными версиями (RCU). Запрос закрепляет версию,
+// на которой начался, и не ждёт писателей. Писатель меняет свою закрытую копию и атомарно
+// публикует её. Старая версия возвращается писателю, когда её отпускает последний читатель,
+// и догоняет новую повтором журнала изменений, так что полная копия индекса нужна, только если
+// читатель держит старую версию слишком долго. В памяти живут две версии индекса.
+class VersionedSearchServer
+{
+private:
+    struct Operation
+    {
+        bool is_removal = false;
+        int document_id = 0;
+        std::string document;
+        DocumentStatus status = DocumentStatus::ACTUAL;
+        std::vector<int> ratings;
+    };
+
+    // читается и подменяется через std::atomic_load / std::atomic_store
+    std::shared_ptr<const SearchServer> current_;
+    std::atomic<uint64_t> generation_ = 0;
+
+    mutable std::mutex write_m_;
+    size_t publish_interval_;
+    std::shared_ptr<SearchServer> published_;
+    std::shared_ptr<std::atomic<bool>> published_released_; // читатели отпустили published_
+    std::shared_ptr<SearchServer> pending_;
+    std::vector<Operation> log_;         // изменения pending_ относительно published_
+    std::shared_ptr<SearchServer> retired_;
+    std::shared_ptr<std::atomic<bool>> retired_released_;
+    std::vector<Operation> replay_log_;  // изменения published_ относительно retired_
+
+    void PreparePending();
+    void Apply(Operation operation);
+    void PublishLocked();
+    static void Replay(SearchServer& search_server, const Operation& operation);
+    // Указатель для читателей со своим счётчиком ссылок. Когда его отпускает последний читатель,
+    // released выставляется с release-семантикой: прочитав флаг с acquire, писатель может менять версию.
+    static std::shared_ptr<const SearchServer> MakeSnapshot(std::shared_ptr<SearchServer> index, std::shared_ptr<std::atomic<bool>> released);
+
+public:
+    //------------------CONSTRUCTORS-----------------//
+    // publish_interval - через сколько изменений версия публикуется автоматически, 0 - только через Publish()
+    template <typename StringCollection>
+    explicit VersionedSearchServer(const StringCollection& stop_words, size_t publish_interval = DEFAULT_PUBLISH_INTERVAL);
+    explicit VersionedSearchServer(const std::string& stop_words, size_t publish_interval = DEFAULT_PUBLISH_INTERVAL);
+    explicit VersionedSearchServer(std::string_view stop_words, size_t publish_interval = DEFAULT_PUBLISH_INTERVAL);
+
+    //------------------METHODS-----------------//
+    void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+    void RemoveDocument(int document_id);
+    // Делает накопленные изменения видимыми запросам
+    void Publish();
+
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status, size_t max_count = MAX_RESULT_DOCUMENT_COUNT) const;
+    std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+
+    //------------------GETS-----------------//
+    // Текущая опубликованная версия. Пока указатель жив, версия не меняется: MatchDocument,
+    // GetWordFrequencies и итерацию по id нужно делать через неё.
+    std::shared_ptr<const SearchServer> GetSnapshot() const;
+    uint64_t GetGeneration() const;
+    size_t GetDocumentCount() const;
+};
+
+template <typename StringCollection>
+VersionedSearchServer::VersionedSearchServer(const StringCollection& stop_words, size_t publish_interval)
+    : publish_interval_(publish_interval)
+    , published_(std::make_shared<SearchServer>(stop_words))
+    , published_released_(std::make_shared<std::atomic<bool>>(false))
+{
+    std::atomic_store(&current_, MakeSnapshot(published_, published_released_));
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> VersionedSearchServer::FindTopDocuments(const std::string_view& raw_query, DocumentPredicate document_predicate, size_t max_count) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query, document_predicate, max_count);
+}